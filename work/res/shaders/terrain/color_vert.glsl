@@ -8,12 +8,20 @@ uniform vec4 uClipPlane;
 
 //uniform float[201*201] trasitionHeightOffsets;
 
+// displacement mode: the mesh is a flat grid, heights and water volume come from these textures
+// (with the height map's 1 sample border) and the normals from their differences
+uniform bool uDisplace;
+uniform sampler2D uHeightMap;
+uniform sampler2D uWaterMap;
+uniform float scale;
+
 // mesh data
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoord;
 layout(location = 3) in float atransitionOffset;
 layout(location = 4) in float aWaterVolume;
+layout(location = 5) in float aHeight; // split meshes keep the height apart from the grid, 0 for other meshes
 
 // model data (this must match the input of the vertex shader)
 out VertexData {
@@ -27,19 +35,36 @@ out VertexData {
 } v_out;
 
 void main() {
+	vec3 position = aPosition + vec3(0, aHeight, 0);
+	vec3 normal = aNormal;
+	float waterVolume = aWaterVolume;
+
+	if (uDisplace) {
+		ivec2 texel = ivec2(aTexCoord) + 1; // skip the border
+		position.y = texelFetch(uHeightMap, texel, 0).r;
+		waterVolume = texelFetch(uWaterMap, texel, 0).r;
+
+		// central differences, the same as the CPU normals of an eroded height map
+		float left = texelFetch(uHeightMap, texel - ivec2(1, 0), 0).r;
+		float right = texelFetch(uHeightMap, texel + ivec2(1, 0), 0).r;
+		float down = texelFetch(uHeightMap, texel - ivec2(0, 1), 0).r;
+		float up = texelFetch(uHeightMap, texel + ivec2(0, 1), 0).r;
+		normal = normalize(vec3(left / scale - right / scale, 2, down / scale - up / scale));
+	}
+
     // Calculates whether this vertex should be clipped or not
-    gl_ClipDistance[0] = dot(vec4(aPosition, 1), uClipPlane);
+    gl_ClipDistance[0] = dot(vec4(position, 1), uClipPlane);
 
 	// transform vertex data to viewspace
-	v_out.position = (uModelViewMatrix * vec4(aPosition, 1)).xyz;
-	v_out.world_pos = aPosition;
-	v_out.normal = normalize((uModelViewMatrix * vec4(aNormal, 0)).xyz);
-	v_out.world_normal = normalize(aNormal);
+	v_out.position = (uModelViewMatrix * vec4(position, 1)).xyz;
+	v_out.world_pos = position;
+	v_out.normal = normalize((uModelViewMatrix * vec4(normal, 0)).xyz);
+	v_out.world_normal = normalize(normal);
 	v_out.textureCoord = aTexCoord;
 	int i = 201 * int(aTexCoord.y) + int(aTexCoord.x);
 	v_out.transitionOffset = atransitionOffset * 0.3f;
-	v_out.waterVolume = aWaterVolume;
+	v_out.waterVolume = waterVolume;
 
 	// set the screenspace position (needed for converting to fragment data)
-	gl_Position = uProjectionMatrix * uModelViewMatrix * vec4(aPosition, 1);
+	gl_Position = uProjectionMatrix * uModelViewMatrix * vec4(position, 1);
 }
\ No newline at end of file
@@ -83,6 +83,7 @@ void Application::renderGUI()
 
     // display current camera parameters
     ImGui::Text("Application %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::Text("GL objects: %d (%.1f MB)", gl_resource_stats::get().total_live(), gl_resource_stats::get().total_bytes() / 1048576.0);
     // ImGui::SliderFloat("Pitch", &m_pitch, -pi<float>() / 2, pi<float>() / 2, "%.2f");
     // ImGui::SliderFloat("Yaw", &m_yaw, -pi<float>(), pi<float>(), "%.2f");
     // ImGui::SliderFloat("Distance", &m_distance, 0, 100, "%.2f", 2.0f);
@@ -0,0 +1,82 @@
+// std
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// project
+#include "allocation_counter.hpp"
+
+
+namespace {
+
+	std::atomic<std::size_t> allocations(0);
+
+	void* allocate(std::size_t size) {
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		void* p = std::malloc(size ? size : 1);
+		if (!p) throw std::bad_alloc();
+		return p;
+	}
+
+	//over-allocates with malloc and keeps the pointer malloc returned just before the aligned
+	//block, std::aligned_alloc isn't available everywhere
+	void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+		const std::size_t align = std::max(std::size_t(alignment), sizeof(void*));
+		void* raw = allocate(size + align + sizeof(void*));
+		std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+		std::uintptr_t aligned = (start + align - 1) & ~std::uintptr_t(align - 1);
+		reinterpret_cast<void**>(aligned)[-1] = raw;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	void freeAligned(void* p) {
+		if (p) std::free(static_cast<void**>(p)[-1]);
+	}
+}
+
+
+namespace bake {
+
+	std::size_t allocationCount() {
+		return allocations.load(std::memory_order_relaxed);
+	}
+}
+
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try { return allocate(size); }
+	catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	try { return allocate(size); }
+	catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	try { return allocateAligned(size, alignment); }
+	catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	try { return allocateAligned(size, alignment); }
+	catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
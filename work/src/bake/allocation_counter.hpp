@@ -0,0 +1,12 @@
+#pragma once
+
+// std
+#include <cstddef>
+
+namespace bake {
+
+	// Number of heap allocations (calls of the global operator new, in any of its forms) the
+	// program has made so far, on any thread. allocation_counter.cpp replaces the global
+	// operator new and delete to count them, so it is only linked into erosion_allocation_check.
+	std::size_t allocationCount();
+}
@@ -0,0 +1,136 @@
+// Checks that erosion iterations on the same map make no heap allocations.
+// Erodes a generated terrain in place with every erosion type, update and hydraulic model, once
+// on a single thread and once on a pool, and counts the allocations (allocation_counter.cpp) of
+// every iteration after the first, which sizes the scratch fields. Exits with 1 if any allocated.
+//
+//   erosion_allocation_check --size 257 --iterations 5 --threads 4
+
+// std
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// project
+#include "terrain/erosion.hpp"
+#include "terrain/generator.hpp"
+#include "terrain/permutation_cache.hpp"
+#include "terrain/thread_pool.hpp"
+#include "allocation_counter.hpp"
+
+
+using namespace std;
+using namespace terrain;
+
+namespace {
+
+	struct Options {
+		int size = 201;
+		int iterations = 5;
+		unsigned threads = 0;
+	};
+
+	void printUsage() {
+		cout << "Usage: erosion_allocation_check [options]\n"
+			"  --size N        samples along each side of the terrain (default 201)\n"
+			"  --iterations N  iterations of each erosion, the first isn't counted (default 5)\n"
+			"  --threads N     threads of the second run, 0 for one per core (default 0)\n";
+	}
+
+	// returns false (after printing why) if the arguments are invalid
+	bool parseArgs(int argc, char** argv, Options& opt) {
+		for (int i = 1; i < argc; i++) {
+			string arg = argv[i];
+			try {
+				if (arg == "--help" || arg == "-h") {
+					printUsage();
+					exit(0);
+				}
+				if (i + 1 >= argc) throw invalid_argument("expected a value");
+				if (arg == "--size") opt.size = stoi(argv[++i]);
+				else if (arg == "--iterations") opt.iterations = stoi(argv[++i]);
+				else if (arg == "--threads") opt.threads = unsigned(stoul(argv[++i]));
+				else throw invalid_argument("unknown option");
+			}
+			catch (exception& e) {
+				cerr << "Error: " << arg << ": " << e.what() << endl;
+				return false;
+			}
+		}
+
+		if (opt.size < 2 || opt.iterations < 2) {
+			cerr << "Error: size and iterations must be at least 2" << endl;
+			return false;
+		}
+		return true;
+	}
+
+
+	// allocations in the iterations after the first of one erosion of terrain
+	size_t countAllocations(const Heightfield& terrain, const ErosionParams& params, int iterations, ThreadPool& pool) {
+		Heightfield heightMap = terrain;
+		Heightfield waterVolume(heightMap.width(), heightMap.height(), heightMap.border());
+		Heightfield sedimentVolume(heightMap.width(), heightMap.height(), heightMap.border());
+		ErosionState state;
+
+		size_t allocations = 0;
+		for (int i = 0; i < iterations; i++) {
+			size_t before = bake::allocationCount();
+			erodeTerrainIteration(heightMap.view(), waterVolume.view(), sedimentVolume.view(), params, i, iterations, state, pool);
+			if (i > 0) allocations += bake::allocationCount() - before;
+		}
+		return allocations;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	Options opt;
+	if (!parseArgs(argc, argv, opt)) {
+		printUsage();
+		return 1;
+	}
+
+	ThreadPool serial(1);
+	ThreadPool pool(opt.threads);
+
+	GenerationParams generation;
+	generation.size = opt.size;
+	shared_ptr<const PermutationTable> perm = PermutationCache::shared().get(0);
+	const Heightfield terrain = generateHeightfield(generation, *perm, nullptr, pool);
+
+	const char* updates[] = { "inplace", "jacobi", "coloured" };
+	const char* models[] = { "cells", "pipes", "droplets" };
+
+	cout << "Heap allocations in " << opt.iterations - 1 << " iterations after the first, " << opt.size << "x" << opt.size << endl;
+	cout << "  erosion    update    hydraulic  1 thread  " << pool.size() << " threads" << endl;
+	int failed = 0;
+	for (ErosionType type : { ErosionType::Terraces, ErosionType::Realistic }) {
+		for (int update = 0; update < 3; update++) {
+			//terraces have no hydraulic step
+			int numModels = type == ErosionType::Terraces ? 1 : 3;
+			for (int model = 0; model < numModels; model++) {
+				ErosionParams params;
+				params.type = type;
+				params.thermalUpdate = ErosionUpdate(update);
+				params.hydraulic = HydraulicModel(model);
+
+				size_t serialAllocations = countAllocations(terrain, params, opt.iterations, serial);
+				size_t poolAllocations = countAllocations(terrain, params, opt.iterations, pool);
+				if (serialAllocations > 0 || poolAllocations > 0) failed++;
+
+				cout << "  " << left << setw(11) << (type == ErosionType::Terraces ? "terraces" : "realistic") << setw(10) << updates[update]
+					<< setw(11) << (type == ErosionType::Terraces ? "-" : models[model]) << right << setw(8) << serialAllocations
+					<< setw(11) << poolAllocations << endl;
+			}
+		}
+	}
+
+	if (failed > 0) {
+		cerr << "Error: " << failed << " erosions allocated after their first iteration" << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+// project
+#include "heightmap_io.hpp"
+
+
+// zlib deflate from stb_image_write (compiled into the stb library), which is all a PNG needs
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+
+using namespace std;
+
+namespace bake {
+
+	namespace {
+		uint32_t crc32(const unsigned char* data, size_t length, uint32_t crc = 0) {
+			//built once, thread safe since terrains are written from several threads
+			static const array<uint32_t, 256> table = [] {
+				array<uint32_t, 256> t;
+				for (uint32_t i = 0; i < 256; i++) {
+					uint32_t c = i;
+					for (int k = 0; k < 8; k++) {
+						c = (c & 1) ? 0xedb88320u ^ (c >> 1) : (c >> 1);
+					}
+					t[i] = c;
+				}
+				return t;
+			}();
+
+			crc = ~crc;
+			for (size_t i = 0; i < length; i++) {
+				crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+			}
+			return ~crc;
+		}
+
+		void putBigEndian32(vector<unsigned char>& out, uint32_t v) {
+			out.push_back((unsigned char)(v >> 24));
+			out.push_back((unsigned char)(v >> 16));
+			out.push_back((unsigned char)(v >> 8));
+			out.push_back((unsigned char)v);
+		}
+
+		// length, type, data, crc of (type + data)
+		void writeChunk(ofstream& file, const char* type, const unsigned char* data, size_t length) {
+			vector<unsigned char> chunk;
+			putBigEndian32(chunk, uint32_t(length));
+			chunk.insert(chunk.end(), type, type + 4);
+			chunk.insert(chunk.end(), data, data + length);
+			putBigEndian32(chunk, crc32(chunk.data() + 4, length + 4));
+			file.write((const char*)chunk.data(), chunk.size());
+		}
+	}
+
+
+	bool writeRaw(const string& filename, terrain::ConstHeightfieldView heights) {
+		ofstream file(filename, ios::binary);
+		if (!file) return false;
+
+		for (int y = 0; y < heights.height; y++) {
+			file.write((const char*)heights.row(y), sizeof(float) * heights.width);
+		}
+		return bool(file);
+	}
+
+
+	bool writePng16(const string& filename, terrain::ConstHeightfieldView heights, float minHeight, float maxHeight) {
+		const int width = heights.width;
+		const int height = heights.height;
+		const float range = maxHeight > minHeight ? maxHeight - minHeight : 1.0f;
+
+		// each scanline is a filter type byte (0, none) then big endian 16 bit samples
+		vector<unsigned char> scanlines;
+		scanlines.reserve(size_t(height) * (1 + 2 * width));
+		for (int y = 0; y < height; y++) {
+			const float* row = heights.row(y);
+			scanlines.push_back(0);
+			for (int x = 0; x < width; x++) {
+				float t = std::min(1.0f, std::max(0.0f, (row[x] - minHeight) / range));
+				uint16_t v = uint16_t(std::lround(t * 65535.0f));
+				scanlines.push_back((unsigned char)(v >> 8));
+				scanlines.push_back((unsigned char)v);
+			}
+		}
+
+		int compressedLength = 0;
+		unsigned char* compressed = stbi_zlib_compress(scanlines.data(), int(scanlines.size()), &compressedLength, 8);
+		if (!compressed) return false;
+
+		ofstream file(filename, ios::binary);
+		if (!file) {
+			free(compressed);
+			return false;
+		}
+
+		static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+		file.write((const char*)signature, sizeof(signature));
+
+		// 16 bit greyscale, deflate, no filtering across lines, not interlaced
+		vector<unsigned char> header;
+		putBigEndian32(header, uint32_t(width));
+		putBigEndian32(header, uint32_t(height));
+		header.insert(header.end(), { 16, 0, 0, 0, 0 });
+		writeChunk(file, "IHDR", header.data(), header.size());
+		writeChunk(file, "IDAT", compressed, size_t(compressedLength));
+		writeChunk(file, "IEND", nullptr, 0);
+
+		free(compressed);
+		return bool(file);
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// std
+#include <string>
+
+// project
+#include "terrain/heightfield.hpp"
+
+namespace bake {
+
+	// Writes the interior of the height map as raw 32 bit floats, row by row, in the machine's byte order.
+	// Returns false if the file couldn't be written.
+	bool writeRaw(const std::string& filename, terrain::ConstHeightfieldView heights);
+
+	// Writes the interior of the height map as a 16 bit greyscale PNG, with minHeight mapped to 0 and
+	// maxHeight to 65535 (heights outside the range are clamped).
+	// Returns false if the file couldn't be written.
+	bool writePng16(const std::string& filename, terrain::ConstHeightfieldView heights, float minHeight, float maxHeight);
+}
@@ -0,0 +1,420 @@
+// Headless terrain baking tool.
+// Generates (and optionally erodes) a batch of terrains with the same code as the interactive
+// terrain renderer, writes their height maps to disk and reports how long each stage took.
+//
+//   terrain_bake --count 100 --erosion realistic --iterations 40 --out baked/
+//   terrain_bake --bench-noise --octaves 8
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "terrain/erosion.hpp"
+#include "terrain/fbm.hpp"
+#include "terrain/generator.hpp"
+#include "terrain/heightmap_cache.hpp"
+#include "terrain/noise.hpp"
+#include "terrain/permutation_cache.hpp"
+#include "terrain/thread_pool.hpp"
+#include "heightmap_io.hpp"
+
+
+using namespace std;
+using namespace terrain;
+
+namespace {
+
+	struct Options {
+		GenerationParams generation;
+		ErosionParams erosion;
+		bool erode = false;
+		int iterations = 40;
+
+		int count = 1;
+		bool benchNoise = false;
+		uint64_t seed = 0;
+		unsigned threads = 0;
+
+		string outDir = "baked";
+		string cacheDir; // empty for no cache
+		bool writeRaw = true;
+		bool writePng = true;
+		bool fixedRange = false;
+		float minHeight = 0;
+		float maxHeight = 0;
+	};
+
+	struct BakeResult {
+		uint64_t seed = 0;
+		double generateMs = 0;
+		double erodeMs = 0;
+		double writeMs = 0;
+		bool generateCached = false;
+		bool erodeCached = false;
+		float minHeight = 0;
+		float maxHeight = 0;
+		bool written = false;
+	};
+
+
+	void printUsage() {
+		cout << "Usage: terrain_bake [options]\n"
+			"\n"
+			"Output:\n"
+			"  --out DIR                    output directory (default baked)\n"
+			"  --count N                    number of terrains (default 1)\n"
+			"  --seed S                     64 bit seed of the first terrain, terrain i uses S + i (default 0,\n"
+			"                               the reference permutation); same seeds as the terrain renderer\n"
+			"  --format raw|png|both        height map format (default both)\n"
+			"  --png-range MIN MAX          height mapped to 0 and 65535 (default each terrain's own range)\n"
+			"  --threads N                  worker threads, 0 for one per core (default 0)\n"
+			"  --bench-noise                compare the samples per second of every noise basis, raw and in\n"
+			"                               the fbm with the base terrain options, then exit\n"
+			"  --cache DIR                  reuse generated and eroded height maps stored in DIR, 'default'\n"
+			"                               for the terrain renderer's cache (default no cache)\n"
+			"\n"
+			"Base terrain:\n"
+			"  --size N                     samples along each side (default 201)\n"
+			"  --square-size F              distance between samples (default 0.5)\n"
+			"  --fractal normal|valleys|hybrid\n"
+			"  --noise perlin|hash|simplex  noise basis (default perlin)\n"
+			"  --scale F  --base-frequency F  --octaves N (at most 16)\n"
+			"  --frequency-multiplier F  --amptitude-multiplier F  --offset F  --H F\n"
+			"\n"
+			"Erosion:\n"
+			"  --erosion none|terraces|realistic (default none)\n"
+			"  --iterations N  --talus F  --sediment F  --kr F  --ks F  --ke F  --kc F\n"
+			"  --thermal-update inplace|jacobi|coloured  serial sweep, threaded double buffered or threaded\n"
+			"      in place in 9 colour passes (default inplace)\n"
+			"  --traversal tiled|columns  order of the in place sweeps, columns is the original (default tiled)\n"
+			"  --hydraulic cells|pipes|droplets  per cell water moves, the threaded shallow water model or\n"
+			"      batches of droplets (default cells)\n"
+			"  --droplets F  droplets per cell per iteration  --droplet-lifetime N  (defaults 0.25, 30)\n";
+	}
+
+
+	// returns false (after printing why) if the arguments are invalid
+	bool parseArgs(int argc, char** argv, Options& opt) {
+		// flags that take one value
+		map<string, function<void(const string&)>> flags = {
+			{ "--out", [&](const string& v) { opt.outDir = v; } },
+			{ "--cache", [&](const string& v) { opt.cacheDir = v == "default" ? HeightmapCache::defaultDirectory() : v; } },
+			{ "--count", [&](const string& v) { opt.count = stoi(v); } },
+			{ "--seed", [&](const string& v) { opt.seed = stoull(v); } },
+			{ "--threads", [&](const string& v) { opt.threads = unsigned(stoul(v)); } },
+			{ "--size", [&](const string& v) { opt.generation.size = stoi(v); } },
+			{ "--square-size", [&](const string& v) { opt.generation.squareSize = stof(v); } },
+			{ "--scale", [&](const string& v) { opt.generation.scale = stof(v); } },
+			{ "--base-frequency", [&](const string& v) { opt.generation.fractal.baseFrequency = stof(v); } },
+			{ "--octaves", [&](const string& v) { opt.generation.fractal.numOctaves = stoi(v); } },
+			{ "--frequency-multiplier", [&](const string& v) { opt.generation.fractal.frequencyMultiplier = stof(v); } },
+			{ "--amptitude-multiplier", [&](const string& v) { opt.generation.fractal.amtitudeMultiplier = stof(v); } },
+			{ "--offset", [&](const string& v) { opt.generation.fractal.offset = stof(v); } },
+			{ "--H", [&](const string& v) { opt.generation.fractal.H = stof(v); } },
+			{ "--iterations", [&](const string& v) { opt.iterations = stoi(v); } },
+			{ "--talus", [&](const string& v) { opt.erosion.talusThreshold = stof(v); } },
+			{ "--sediment", [&](const string& v) { opt.erosion.sedimentvolume = stof(v); } },
+			{ "--kr", [&](const string& v) { opt.erosion.kr = stof(v); } },
+			{ "--ks", [&](const string& v) { opt.erosion.ks = stof(v); } },
+			{ "--ke", [&](const string& v) { opt.erosion.ke = stof(v); } },
+			{ "--kc", [&](const string& v) { opt.erosion.kc = stof(v); } },
+			{ "--droplets", [&](const string& v) { opt.erosion.dropletsPerCell = stof(v); } },
+			{ "--droplet-lifetime", [&](const string& v) { opt.erosion.dropletLifetime = stoi(v); } },
+			{ "--fractal", [&](const string& v) {
+				if (v == "normal") opt.generation.fractal.type = FractalType::Homogeneous;
+				else if (v == "valleys") opt.generation.fractal.type = FractalType::Heterogeneous;
+				else if (v == "hybrid") opt.generation.fractal.type = FractalType::HybridMultifractal;
+				else throw invalid_argument("unknown fractal type " + v);
+			} },
+			{ "--noise", [&](const string& v) {
+				if (v == "perlin") opt.generation.fractal.basis = NoiseBasis::Perlin;
+				else if (v == "hash") opt.generation.fractal.basis = NoiseBasis::Hash;
+				else if (v == "simplex") opt.generation.fractal.basis = NoiseBasis::Simplex;
+				else throw invalid_argument("unknown noise basis " + v);
+			} },
+			{ "--erosion", [&](const string& v) {
+				opt.erode = v != "none";
+				if (v == "terraces") opt.erosion.type = ErosionType::Terraces;
+				else if (v == "realistic") opt.erosion.type = ErosionType::Realistic;
+				else if (v != "none") throw invalid_argument("unknown erosion type " + v);
+			} },
+			{ "--thermal-update", [&](const string& v) {
+				if (v == "inplace") opt.erosion.thermalUpdate = ErosionUpdate::InPlace;
+				else if (v == "jacobi") opt.erosion.thermalUpdate = ErosionUpdate::Jacobi;
+				else if (v == "coloured") opt.erosion.thermalUpdate = ErosionUpdate::Coloured;
+				else throw invalid_argument("unknown thermal update " + v);
+			} },
+			{ "--traversal", [&](const string& v) {
+				if (v == "tiled") opt.erosion.traversal = ErosionTraversal::Tiled;
+				else if (v == "columns") opt.erosion.traversal = ErosionTraversal::Columns;
+				else throw invalid_argument("unknown traversal " + v);
+			} },
+			{ "--hydraulic", [&](const string& v) {
+				if (v == "cells") opt.erosion.hydraulic = HydraulicModel::Cells;
+				else if (v == "pipes") opt.erosion.hydraulic = HydraulicModel::Pipes;
+				else if (v == "droplets") opt.erosion.hydraulic = HydraulicModel::Droplets;
+				else throw invalid_argument("unknown hydraulic model " + v);
+			} },
+			{ "--format", [&](const string& v) {
+				if (v != "raw" && v != "png" && v != "both") throw invalid_argument("unknown format " + v);
+				opt.writeRaw = v != "png";
+				opt.writePng = v != "raw";
+			} },
+		};
+
+		for (int i = 1; i < argc; i++) {
+			string arg = argv[i];
+			try {
+				if (arg == "--help" || arg == "-h") {
+					printUsage();
+					exit(0);
+				}
+				else if (arg == "--bench-noise") {
+					opt.benchNoise = true;
+				}
+				else if (arg == "--png-range") {
+					if (i + 2 >= argc) throw invalid_argument("expected two values");
+					opt.fixedRange = true;
+					opt.minHeight = stof(argv[++i]);
+					opt.maxHeight = stof(argv[++i]);
+				}
+				else {
+					auto flag = flags.find(arg);
+					if (flag == flags.end()) throw invalid_argument("unknown option");
+					if (i + 1 >= argc) throw invalid_argument("expected a value");
+					flag->second(argv[++i]);
+				}
+			}
+			catch (exception& e) {
+				cerr << "Error: " << arg << ": " << e.what() << endl;
+				return false;
+			}
+		}
+
+		if (opt.count < 1 || opt.generation.size < 2 || opt.iterations < 0) {
+			cerr << "Error: count must be at least 1, size at least 2 and iterations can't be negative" << endl;
+			return false;
+		}
+		if (opt.generation.fractal.numOctaves < 0 || opt.generation.fractal.numOctaves > OctaveTable::maxOctaves) {
+			cerr << "Error: octaves must be between 0 and " << OctaveTable::maxOctaves << endl;
+			return false;
+		}
+		return true;
+	}
+
+
+	double millisecondsSince(chrono::steady_clock::time_point start) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+
+	string terrainFilename(const Options& opt, int index, const char* extension) {
+		ostringstream name;
+		name << "terrain_" << setw(4) << setfill('0') << index << extension;
+		return (filesystem::path(opt.outDir) / name.str()).string();
+	}
+
+
+	BakeResult bakeTerrain(const Options& opt, int index, ThreadPool& pool) {
+		BakeResult result;
+		result.seed = opt.seed + index;
+
+		HeightmapCache cache(opt.cacheDir);
+
+		//the normals are only made for the cache, so its entries are the same as the renderer's
+		auto start = chrono::steady_clock::now();
+		Heightfield heightMap;
+		CacheKey terrainKey = generationKey(result.seed, opt.generation);
+		result.generateCached = cache.load(terrainKey, heightMap);
+		if (!result.generateCached) {
+			shared_ptr<const PermutationTable> perm = PermutationCache::shared().get(result.seed);
+			vector<glm::vec3> normals;
+			heightMap = generateHeightfield(opt.generation, *perm, cache.enabled() ? &normals : nullptr, pool);
+			cache.store(terrainKey, heightMap, nullptr, &normals);
+		}
+		result.generateMs = millisecondsSince(start);
+
+		if (opt.erode) {
+			start = chrono::steady_clock::now();
+			Heightfield waterVolume(heightMap.width(), heightMap.height(), heightMap.border());
+			CacheKey erodedKey = erosionKey(terrainKey, opt.erosion, opt.iterations);
+			result.erodeCached = cache.load(erodedKey, heightMap, &waterVolume);
+			if (!result.erodeCached) {
+				Heightfield sedimentVolume(heightMap.width(), heightMap.height(), heightMap.border());
+				erodeTerrain(heightMap.view(), waterVolume.view(), sedimentVolume.view(), opt.erosion, opt.iterations, pool);
+				cache.store(erodedKey, heightMap, &waterVolume);
+			}
+			result.erodeMs = millisecondsSince(start);
+		}
+
+		result.minHeight = heightMap(0, 0);
+		result.maxHeight = heightMap(0, 0);
+		for (int y = 0; y < heightMap.height(); y++) {
+			const float* row = heightMap.row(y);
+			auto range = minmax_element(row, row + heightMap.width());
+			result.minHeight = min(result.minHeight, *range.first);
+			result.maxHeight = max(result.maxHeight, *range.second);
+		}
+
+		start = chrono::steady_clock::now();
+		result.written = true;
+		if (opt.writeRaw) {
+			result.written &= bake::writeRaw(terrainFilename(opt, index, ".raw"), heightMap.view());
+		}
+		if (opt.writePng) {
+			float lo = opt.fixedRange ? opt.minHeight : result.minHeight;
+			float hi = opt.fixedRange ? opt.maxHeight : result.maxHeight;
+			result.written &= bake::writePng16(terrainFilename(opt, index, ".png"), heightMap.view(), lo, hi);
+		}
+		result.writeMs = millisecondsSince(start);
+
+		return result;
+	}
+
+
+	// Single threaded samples per second of each noise basis: the raw batch kernel with and without
+	// the gradient, and the fbm with the gradient as the generator uses it. Best of a few runs.
+	void benchNoise(const Options& opt) {
+		const int n = 1 << 14;
+		const int rounds = 20;
+		const int runs = 5;
+
+		//a terrain's worth of sample positions in row order, like the generator passes them
+		vector<float> xs(n), ys(n), out(n), dxs(n), dys(n);
+		const int width = 128;
+		for (int i = 0; i < n; i++) {
+			xs[i] = (i % width + 1) * opt.generation.squareSize;
+			ys[i] = (i / width + 1) * opt.generation.squareSize;
+		}
+		PermutationTable perm = makePermutationTable(opt.seed);
+
+		auto samplesPerSecond = [&](const function<void()>& run) {
+			double best = 0;
+			for (int r = 0; r < runs; r++) {
+				auto start = chrono::steady_clock::now();
+				for (int i = 0; i < rounds; i++) run();
+				best = max(best, double(n) * rounds / (millisecondsSince(start) / 1000.0));
+			}
+			return best;
+		};
+
+		const pair<NoiseBasis, const char*> bases[] = {
+			{ NoiseBasis::Perlin, "perlin" }, { NoiseBasis::Hash, "hash" }, { NoiseBasis::Simplex, "simplex" }
+		};
+		double perlinFbm = 0;
+
+		cout << "Noise samples per second (millions), " << perlinNoiseBatchWidth() << " wide kernels, fbm with "
+			<< opt.generation.fractal.numOctaves << " octaves" << endl;
+		cout << "  basis       noise  noise+grad   fbm+grad  fbm vs perlin" << endl;
+		cout << fixed << setprecision(1);
+		for (auto& basis : bases) {
+			FractalParams fractal = opt.generation.fractal;
+			fractal.basis = basis.first;
+			Fbm fbm(fractal, perm);
+
+			//scale the positions to the first octave, the raw kernels see about the same lattice cells
+			vector<float> bx(n), by(n);
+			for (int i = 0; i < n; i++) {
+				bx[i] = xs[i] * fractal.baseFrequency;
+				by[i] = ys[i] * fractal.baseFrequency;
+			}
+
+			double noise = samplesPerSecond([&] { noiseBatch(basis.first, perm, bx.data(), by.data(), out.data(), n); });
+			double gradient = samplesPerSecond([&] { noiseBatch(basis.first, perm, bx.data(), by.data(), out.data(), dxs.data(), dys.data(), n); });
+			double fractalRate = samplesPerSecond([&] { fbm.evaluate(xs.data(), ys.data(), out.data(), dxs.data(), dys.data(), n); });
+			if (basis.first == NoiseBasis::Perlin) perlinFbm = fractalRate;
+
+			cout << "  " << left << setw(8) << basis.second << right << setw(10) << noise / 1e6 << setw(12) << gradient / 1e6
+				<< setw(11) << fractalRate / 1e6 << setw(14) << fractalRate / perlinFbm << "x" << endl;
+		}
+	}
+
+
+	void writeReport(const Options& opt, const vector<BakeResult>& results, double totalMs, unsigned threads) {
+		string filename = (filesystem::path(opt.outDir) / "timing_report.csv").string();
+		ofstream report(filename);
+		report << "index,seed,generate_ms,erode_ms,write_ms,min_height,max_height,generate_cached,erode_cached\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const BakeResult& r = results[i];
+			report << i << ',' << r.seed << ',' << r.generateMs << ',' << r.erodeMs << ',' << r.writeMs << ','
+				<< r.minHeight << ',' << r.maxHeight << ',' << r.generateCached << ',' << r.erodeCached << '\n';
+		}
+
+		double generateMs = 0, erodeMs = 0, writeMs = 0;
+		int cacheHits = 0;
+		for (const BakeResult& r : results) {
+			generateMs += r.generateMs;
+			erodeMs += r.erodeMs;
+			writeMs += r.writeMs;
+			cacheHits += int(r.generateCached) + int(r.erodeCached);
+		}
+		double n = double(results.size());
+
+		cout << fixed << setprecision(2);
+		cout << "Baked " << results.size() << " terrains of " << opt.generation.size << "x" << opt.generation.size
+			<< " on " << threads << " threads in " << totalMs << " ms" << endl;
+		cout << "  average generate " << generateMs / n << " ms, erode " << erodeMs / n << " ms, write " << writeMs / n << " ms" << endl;
+		if (!opt.cacheDir.empty()) {
+			int stages = int(results.size()) * (opt.erode ? 2 : 1);
+			cout << "  " << cacheHits << " of " << stages << " stages loaded from " << opt.cacheDir << endl;
+		}
+		cout << "  " << n / (totalMs / 1000.0) << " terrains/s, report written to " << filename << endl;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	Options opt;
+	if (!parseArgs(argc, argv, opt)) {
+		printUsage();
+		return 1;
+	}
+
+	if (opt.benchNoise) {
+		benchNoise(opt);
+		return 0;
+	}
+
+	error_code ec;
+	filesystem::create_directories(opt.outDir, ec);
+	if (ec) {
+		cerr << "Error: Could not create output directory " << opt.outDir << ": " << ec.message() << endl;
+		return 1;
+	}
+
+	ThreadPool pool(opt.threads);
+	vector<BakeResult> results(opt.count);
+
+	// one terrain per task, generation inside each terrain is split over the same pool
+	auto start = chrono::steady_clock::now();
+	pool.parallelFor(0, opt.count, 1, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			results[i] = bakeTerrain(opt, i, pool);
+		}
+	});
+	double totalMs = millisecondsSince(start);
+
+	int failed = int(count_if(results.begin(), results.end(), [](const BakeResult& r) { return !r.written; }));
+	if (failed > 0) {
+		cerr << "Error: Could not write " << failed << " height maps to " << opt.outDir << endl;
+	}
+
+	writeReport(opt, results, totalMs, pool.size());
+	return failed > 0 ? 1 : 0;
+}
@@ -21,18 +21,16 @@ namespace cgra {
 
 	void gl_mesh::destroy() {
 		// delete the data buffers
-		glDeleteVertexArrays(1, &vao);
-		glDeleteBuffers(1, &vbo);
-		glDeleteBuffers(1, &ibo);
+		*this = gl_mesh();
 	}
 
 
 	gl_mesh mesh_builder::build() const {
 
 		gl_mesh m;
-		glGenVertexArrays(1, &m.vao); // VAO stores information about how the buffers are set up
-		glGenBuffers(1, &m.vbo); // VBO stores the vertex data
-		glGenBuffers(1, &m.ibo); // IBO stores the indices that make up primitives
+		m.vao = gl_object::gen_vertex_array(); // VAO stores information about how the buffers are set up
+		m.vbo = gl_object::gen_buffer(); // VBO stores the vertex data
+		m.ibo = gl_object::gen_buffer(); // IBO stores the indices that make up primitives
 
 
 		// VAO
@@ -45,6 +43,7 @@ namespace cgra {
 		glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
 		// upload ALL the vertex data in one buffer
 		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(mesh_vertex), &vertices[0], GL_STATIC_DRAW);
+		m.vbo.set_bytes(vertices.size() * sizeof(mesh_vertex));
 
 		// this buffer will use location=0 when we use our VAO
 		glEnableVertexAttribArray(0);
@@ -65,6 +64,7 @@ namespace cgra {
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ibo);
 		// upload the indices for drawing primitives
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		m.ibo.set_bytes(sizeof(unsigned int) * indices.size());
 
 
 		// set the index count and draw modes
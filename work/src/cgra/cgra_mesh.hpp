@@ -17,20 +17,21 @@ namespace cgra {
 
 	// A data structure for holding buffer IDs and other information related to drawing.
 	// Also has a helper functions for drawing the mesh and deleting the gl buffers.
+	// Owns its buffers, so it can only be moved; they are deleted with the mesh.
 	// location 1 : positions (vec3)
 	// location 2 : normals (vec3)
 	// location 3 : uv (vec2)
 	struct gl_mesh {
-		GLuint vao = 0;
-		GLuint vbo = 0;
-		GLuint ibo = 0;
+		gl_object vao;
+		gl_object vbo;
+		gl_object ibo;
 		GLenum mode = 0; // mode to draw in, eg: GL_TRIANGLES
 		int index_count = 0; // how many indicies to draw (no primitives)
 
 		// calls the draw function on mesh data
 		void draw();
 
-		// deletes the gl buffers (cleans up all the data)
+		// deletes the gl buffers now instead of with the mesh
 		void destroy();
 	};
 
@@ -12,6 +12,9 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+// std
+#include <cstddef>
+
 
 
 namespace cgra {
@@ -29,6 +32,34 @@ namespace cgra {
 	}
 
 
+	// Counts the OpenGL objects made through gl_object that are still alive, by kind, and the
+	// bytes of storage they were given (see gl_object::set_bytes). A count or byte total that
+	// keeps growing while nothing new is being drawn is a leak. Only touched by the GL thread
+	struct gl_resource_stats {
+		enum kind { buffer, vertex_array, texture, renderbuffer, framebuffer, shader, program, kind_count };
+
+		int live[kind_count] = { };
+		std::size_t bytes[kind_count] = { };
+
+		int total_live() const {
+			int total = 0;
+			for (int count : live) total += count;
+			return total;
+		}
+
+		std::size_t total_bytes() const {
+			std::size_t total = 0;
+			for (std::size_t b : bytes) total += b;
+			return total;
+		}
+
+		static gl_resource_stats & get() {
+			static gl_resource_stats stats;
+			return stats;
+		}
+	};
+
+
 	// gl_object is a helper class that wraps around a GLuint
 	// object id for OpenGL. Does not allow copying (can't be
 	// owned by more than one thing) and deallocates the object
@@ -41,12 +72,24 @@ namespace cgra {
 	private:
 		GLuint m_id = 0;
 		destroyer_t m_dtor;
+		int m_kind = -1; // gl_resource_stats::kind, or -1 if it isn't counted
+		std::size_t m_bytes = 0;
 
 		void destroy() noexcept {
 			if (m_id) {
 				m_dtor(1, &m_id);
 				m_id = 0;
+				if (m_kind >= 0) {
+					gl_resource_stats::get().live[m_kind]--;
+					gl_resource_stats::get().bytes[m_kind] -= m_bytes;
+				}
 			}
+			m_bytes = 0;
+		}
+
+		// counted object
+		gl_object(GLuint id_, destroyer_t dtor_, gl_resource_stats::kind kind_) : m_id(id_), m_dtor(dtor_), m_kind(kind_) {
+			gl_resource_stats::get().live[m_kind]++;
 		}
 
 	public:
@@ -68,17 +111,39 @@ namespace cgra {
 		gl_object(gl_object &&other) noexcept {
 			m_id = other.m_id;
 			m_dtor = other.m_dtor;
+			m_kind = other.m_kind;
+			m_bytes = other.m_bytes;
 			other.m_id = 0;
+			other.m_bytes = 0;
 		}
 
 		gl_object & operator=(gl_object &&other) noexcept {
+			if (this == &other) return *this;
 			destroy();
 			m_id = other.m_id;
 			m_dtor = other.m_dtor;
+			m_kind = other.m_kind;
+			m_bytes = other.m_bytes;
 			other.m_id = 0;
+			other.m_bytes = 0;
 			return *this;
 		}
 
+		// records how much storage the object holds (buffer data, texture images etc.)
+		// for gl_resource_stats, replacing whatever was recorded before
+		void set_bytes(std::size_t bytes) noexcept {
+			if (!m_id) return;
+			if (m_kind >= 0) {
+				gl_resource_stats::get().bytes[m_kind] += bytes;
+				gl_resource_stats::get().bytes[m_kind] -= m_bytes;
+			}
+			m_bytes = bytes;
+		}
+
+		std::size_t bytes() const noexcept {
+			return m_bytes;
+		}
+
 		// implicit GLuint converter
 		// returns the OpenGL identifier for this object
 		operator GLuint() const noexcept {
@@ -105,40 +170,47 @@ namespace cgra {
 		static gl_object gen_buffer() {
 			GLuint o;
 			glGenBuffers(1, &o);
-			return { o, glDeleteBuffers };
+			return { o, glDeleteBuffers, gl_resource_stats::buffer };
 		}
 
 		// returns a gl_object with an OpenGL vertex array identifier
 		static gl_object gen_vertex_array() {
 			GLuint o;
 			glGenVertexArrays(1, &o);
-			return { o, glDeleteVertexArrays };
+			return { o, glDeleteVertexArrays, gl_resource_stats::vertex_array };
 		}
 
 		// returns a gl_object with an OpenGL texture identifier
 		static gl_object gen_texture() {
 			GLuint o;
 			glGenTextures(1, &o);
-			return { o, glDeleteTextures };
+			return { o, glDeleteTextures, gl_resource_stats::texture };
 		}
 
 		// returns a gl_object with an OpenGL framebuffer identifier
 		static gl_object gen_framebuffer() {
 			GLuint o;
 			glGenFramebuffers(1, &o);
-			return { o, glDeleteFramebuffers };
+			return { o, glDeleteFramebuffers, gl_resource_stats::framebuffer };
+		}
+
+		// returns a gl_object with an OpenGL renderbuffer identifier
+		static gl_object gen_renderbuffer() {
+			GLuint o;
+			glGenRenderbuffers(1, &o);
+			return { o, glDeleteRenderbuffers, gl_resource_stats::renderbuffer };
 		}
 
 		// returns a gl_object with an OpenGL shader identifier
 		static gl_object gen_shader(GLenum type) {
 			GLuint o = glCreateShader(type);
-			return { o, [](GLsizei, const GLuint *o) { glDeleteShader(*o); } };
+			return { o, [](GLsizei, const GLuint *o) { glDeleteShader(*o); }, gl_resource_stats::shader };
 		}
 
 		// returns a gl_object with an OpenGL shader program identifier
 		static gl_object gen_program() {
 			GLuint o = glCreateProgram();
-			return { o, [](GLsizei, const GLuint *o) { glDeleteProgram(*o); } };
+			return { o, [](GLsizei, const GLuint *o) { glDeleteProgram(*o); }, gl_resource_stats::program };
 		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace terrain {
+
+	// Runs the most recently posted task on a background thread and keeps its result until it is
+	// polled (normally from the render thread). Tasks can publish intermediate results on the way.
+	// A task only starts once no new task has been posted for the debounce time, so a burst of
+	// changes (dragging a slider) coalesces into one task. Posting also cancels a running task:
+	// its cancel flag is set, and whatever it returns is thrown away.
+	template <typename Result>
+	class BackgroundJob {
+	public:
+		// fills in result, polling cancelled now and then; returns false if it gave up
+		using Task = std::function<bool(Result& result, const std::atomic<bool>& cancelled)>;
+
+		explicit BackgroundJob(std::chrono::milliseconds debounce = std::chrono::milliseconds(30))
+			: m_debounce(debounce), m_thread([this] { workerLoop(); }) { }
+
+		~BackgroundJob() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stopping = true;
+				m_cancelled = true;
+			}
+			m_changed.notify_all();
+			m_thread.join();
+		}
+
+		BackgroundJob(const BackgroundJob&) = delete;
+		BackgroundJob& operator=(const BackgroundJob&) = delete;
+
+		// replaces the task waiting to run (if any), cancels the running one and drops unpolled results
+		void post(Task task) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_waiting = std::move(task);
+				m_postedAt = std::chrono::steady_clock::now();
+				m_cancelled = m_running;
+				m_finished.reset(); // made for whatever this task replaces
+			}
+			m_changed.notify_all();
+		}
+
+		// drops the waiting task, cancels the running one and forgets any unpolled result
+		void cancel() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_waiting = nullptr;
+			m_cancelled = m_running;
+			m_finished.reset();
+		}
+
+		// Hands over an intermediate result (a preview) from inside the running task. poll() returns
+		// it like a finished result, unless the task has been cancelled since.
+		void publish(Result&& result) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_cancelled) m_finished = std::move(result);
+		}
+
+		// moves the newest finished result into result, returns false if there isn't one
+		bool poll(Result& result) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_finished) return false;
+			result = std::move(*m_finished);
+			m_finished.reset();
+			return true;
+		}
+
+		// true while a task is waiting or running
+		bool busy() const {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_waiting != nullptr || m_running;
+		}
+
+	private:
+		std::chrono::milliseconds m_debounce;
+		Task m_waiting;
+		std::chrono::steady_clock::time_point m_postedAt;
+		std::optional<Result> m_finished;
+		std::atomic<bool> m_cancelled{ false };
+		bool m_running = false;
+		bool m_stopping = false;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_changed;
+
+		// declared last so everything above exists before the thread starts
+		std::thread m_thread;
+
+		void workerLoop() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (true) {
+				m_changed.wait(lock, [this] { return m_stopping || m_waiting; });
+				if (m_stopping) return;
+
+				// wait until the posts stop coming, each new one pushes the start back
+				auto startAt = m_postedAt + m_debounce;
+				while (!m_stopping && m_waiting && std::chrono::steady_clock::now() < startAt) {
+					m_changed.wait_until(lock, startAt);
+					startAt = m_postedAt + m_debounce;
+				}
+				if (m_stopping) return;
+				if (!m_waiting) continue; // cancelled while waiting
+
+				Task task = std::move(m_waiting);
+				m_waiting = nullptr;
+				m_cancelled = false;
+				m_running = true;
+				lock.unlock();
+
+				Result result;
+				bool finished = task(result, m_cancelled);
+
+				lock.lock();
+				m_running = false;
+				if (finished && !m_cancelled) {
+					m_finished = std::move(result);
+				}
+			}
+		}
+	};
+}
@@ -0,0 +1,237 @@
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// project
+#include "droplet_erosion.hpp"
+#include "erosion.hpp"
+
+
+namespace terrain {
+
+	namespace {
+
+		const float inertia = 0.05f; //share of the old direction kept each step, the rest follows the slope
+		const float gravity = 4;
+		const float minFall = 0.01f; //droplets on flat ground still carry a little
+		const int brushRadius = 2;
+
+
+		//erosion is spread over the cells within brushRadius, weighted by how close they are, so
+		//droplets cut channels instead of single cell pits
+		struct Brush {
+			int count = 0;
+			int dx[(2 * brushRadius + 1) * (2 * brushRadius + 1)];
+			int dy[(2 * brushRadius + 1) * (2 * brushRadius + 1)];
+			float weight[(2 * brushRadius + 1) * (2 * brushRadius + 1)];
+
+			Brush() {
+				float total = 0;
+				for (int j = -brushRadius; j <= brushRadius; j++) {
+					for (int i = -brushRadius; i <= brushRadius; i++) {
+						float w = brushRadius - std::sqrt(float(i * i + j * j));
+						if (w <= 0) continue;
+						dx[count] = i;
+						dy[count] = j;
+						weight[count] = w;
+						total += w;
+						count++;
+					}
+				}
+				for (int k = 0; k < count; k++) weight[k] /= total;
+			}
+		};
+
+		const Brush brush;
+
+
+		//splitmix64 of the droplet's batch and index, so a batch drops the same droplets every time
+		std::uint64_t dropletRandom(std::uint64_t batch, std::uint64_t index) {
+			std::uint64_t z = batch * 0xD1B54A32D192ED03ull + index * 0x9E3779B97F4A7C15ull;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+
+		//cells a droplet may move through, it stops when it leaves them
+		struct Region {
+			float x0, y0, x1, y1;
+		};
+
+
+		//a droplet on its way down
+		struct Droplet {
+			float x, y;
+			float dirX = 0, dirY = 0;
+			float speed = 1;
+			float water = 1;
+			float sediment = 0;
+			int life = 0;
+
+			Droplet(float x, float y) : x(x), y(y) { }
+		};
+
+
+		void depositAt(HeightfieldView heightMap, float x, float y, float amount) {
+			int ix = int(x), iy = int(y);
+			float fx = x - ix, fy = y - iy;
+			heightMap(ix, iy) += amount * (1 - fx) * (1 - fy);
+			heightMap(ix + 1, iy) += amount * fx * (1 - fy);
+			heightMap(ix, iy + 1) += amount * (1 - fx) * fy;
+			heightMap(ix + 1, iy + 1) += amount * fx * fy;
+		}
+
+
+		//moves the droplet one cell down the slope, eroding or depositing on the way. Returns false
+		//once it has stopped (on flat ground, leaving the region or at the end of its life), after
+		//leaving the sediment it still carries where it stopped
+		bool advance(Droplet& drop, HeightfieldView heightMap, const Region& region, const ErosionParams& params, int lifetime) {
+			const int width = heightMap.width;
+			const int height = heightMap.height;
+			const std::ptrdiff_t stride = heightMap.stride;
+
+			int ix = int(drop.x), iy = int(drop.y);
+			float fx = drop.x - ix, fy = drop.y - iy;
+
+			//height and gradient from the 4 corners of the cell it's in
+			const float* row0 = heightMap.row(iy);
+			const float* row1 = heightMap.row(iy + 1);
+			float h00 = row0[ix], h10 = row0[ix + 1], h01 = row1[ix], h11 = row1[ix + 1];
+			float gradX = (h10 - h00) * (1 - fy) + (h11 - h01) * fy;
+			float gradY = (h01 - h00) * (1 - fx) + (h11 - h10) * fx;
+			float oldHeight = h00 * (1 - fx) * (1 - fy) + h10 * fx * (1 - fy) + h01 * (1 - fx) * fy + h11 * fx * fy;
+
+			float dirX = drop.dirX * inertia - gradX * (1 - inertia);
+			float dirY = drop.dirY * inertia - gradY * (1 - inertia);
+			float length = std::sqrt(dirX * dirX + dirY * dirY);
+			float x = drop.x + dirX / length;
+			float y = drop.y + dirY / length;
+			//flat ground (NaN) fails this too
+			if (!(x >= region.x0 && x < region.x1 && y >= region.y0 && y < region.y1) || drop.life >= lifetime) {
+				depositAt(heightMap, drop.x, drop.y, drop.sediment);
+				return false;
+			}
+
+			int nx = int(x), ny = int(y);
+			float nfx = x - nx, nfy = y - ny;
+			const float* next0 = heightMap.row(ny);
+			const float* next1 = heightMap.row(ny + 1);
+			float newHeight = next0[nx] * (1 - nfx) * (1 - nfy) + next0[nx + 1] * nfx * (1 - nfy)
+				+ next1[nx] * (1 - nfx) * nfy + next1[nx + 1] * nfx * nfy;
+			float fall = oldHeight - newHeight;
+
+			float capacity = std::max(fall, minFall) * drop.speed * drop.water * params.kc;
+			if (drop.sediment > capacity || fall < 0) {
+				//uphill it fills the pit behind it as far as it can, otherwise drops the excess
+				float deposit = fall < 0 ? std::min(-fall, drop.sediment) : (drop.sediment - capacity) * params.ks;
+				drop.sediment -= deposit;
+				depositAt(heightMap, drop.x, drop.y, deposit);
+			}
+			else {
+				//never digs deeper than the fall, that would leave a pit behind
+				float erode = std::min((capacity - drop.sediment) * params.ks, fall);
+				if (ix >= brushRadius && ix < width - brushRadius && iy >= brushRadius && iy < height - brushRadius) {
+					float* centre = heightMap.row(iy) + ix;
+					for (int k = 0; k < brush.count; k++) {
+						centre[brush.dy[k] * stride + brush.dx[k]] -= erode * brush.weight[k];
+					}
+					drop.sediment += erode;
+				}
+				else {
+					for (int k = 0; k < brush.count; k++) {
+						int bx = ix + brush.dx[k], by = iy + brush.dy[k];
+						if (bx < 0 || bx >= width || by < 0 || by >= height) continue;
+						float amount = erode * brush.weight[k];
+						heightMap(bx, by) -= amount;
+						drop.sediment += amount;
+					}
+				}
+			}
+
+			drop.x = x;
+			drop.y = y;
+			drop.dirX = dirX;
+			drop.dirY = dirY;
+			drop.speed = std::sqrt(std::max(0.0f, drop.speed * drop.speed + fall * gravity));
+			drop.water *= 1 - params.ke / lifetime;
+			drop.life++;
+			return true;
+		}
+
+
+	}
+
+
+	void DropletErosion::step(HeightfieldView heightMap, const ErosionParams& params, ThreadPool& pool) {
+		const int width = heightMap.width;
+		const int height = heightMap.height;
+		//the settings come straight from the GUI and command line: no droplets (or NaN) is nothing
+		//to do, and every droplet lives at least one step but not so many the tile size overflows
+		const double droplets = double(params.dropletsPerCell) * width * height;
+		if (width < 2 || height < 2 || !(droplets >= 1)) return;
+		const int count = int(std::min(droplets, double(std::numeric_limits<int>::max())));
+		const int lifetime = std::max(1, std::min(params.dropletLifetime, 1 << 20));
+
+		//a droplet moves one cell a step and reads or writes at most brushRadius + 1 cells from
+		//where it is, so droplets starting two tiles apart can't meet
+		const int margin = lifetime;
+		const int tileSize = 2 * (margin + brushRadius + 1);
+		const int tilesX = (width + tileSize - 1) / tileSize;
+		const int tilesY = (height + tileSize - 1) / tileSize;
+
+		//bucket the droplets by tile (counting sort), keeping their order within a tile
+		auto start = [&](int i) {
+			std::uint64_t r = dropletRandom(m_batch, std::uint64_t(i));
+			//24 bits each, on [0, width - 1) x [0, height - 1) so the 4 corners are in the map
+			float u = float(r & 0xFFFFFF) / float(1 << 24);
+			float v = float((r >> 24) & 0xFFFFFF) / float(1 << 24);
+			return Start{ u * (width - 1), v * (height - 1) };
+		};
+		auto tileOf = [&](const Start& s) {
+			return (int(s.y) / tileSize) * tilesX + int(s.x) / tileSize;
+		};
+		m_tileStarts.assign(size_t(tilesX) * tilesY + 1, 0);
+		for (int i = 0; i < count; i++) {
+			m_tileStarts[tileOf(start(i)) + 1]++;
+		}
+		for (size_t t = 1; t < m_tileStarts.size(); t++) {
+			m_tileStarts[t] += m_tileStarts[t - 1];
+		}
+		m_starts.resize(size_t(count));
+		m_tileEnds.assign(m_tileStarts.begin(), m_tileStarts.end() - 1);
+		for (int i = 0; i < count; i++) {
+			Start s = start(i);
+			m_starts[m_tileEnds[tileOf(s)]++] = s;
+		}
+		m_batch++;
+
+		//each pass runs every second tile in both directions
+		for (int colour = 0; colour < 4; colour++) {
+			m_tiles.clear();
+			for (int ty = colour / 2; ty < tilesY; ty += 2) {
+				for (int tx = colour % 2; tx < tilesX; tx += 2) {
+					m_tiles.push_back(ty * tilesX + tx);
+				}
+			}
+			pool.parallelFor(0, int(m_tiles.size()), 1, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					int tile = m_tiles[i];
+					int tx = tile % tilesX, ty = tile / tilesX;
+					//positions stay inside the map so the 4 corners can be read
+					Region region{
+						float(std::max(0, tx * tileSize - margin)),
+						float(std::max(0, ty * tileSize - margin)),
+						float(std::min(width - 1, (tx + 1) * tileSize + margin)),
+						float(std::min(height - 1, (ty + 1) * tileSize + margin))
+					};
+					for (int d = m_tileStarts[tile]; d < m_tileStarts[tile + 1]; d++) {
+						Droplet drop(m_starts[d].x, m_starts[d].y);
+						while (advance(drop, heightMap, region, params, lifetime)) { }
+					}
+				}
+			});
+		}
+	}
+}
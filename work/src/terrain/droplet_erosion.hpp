@@ -0,0 +1,47 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <vector>
+
+// project
+#include "heightfield.hpp"
+#include "thread_pool.hpp"
+
+namespace terrain {
+
+	struct ErosionParams;
+
+	// Hydraulic erosion by rain droplets that run down the terrain one at a time (Lagrangian),
+	// as in Hans Beyer, "Implementation of a method for hydraulic erosion", 2015.
+	// A droplet rolls downhill with some inertia for up to dropletLifetime cells. Its capacity is
+	// kc * drop * speed * water; it erodes ks of what it can still carry from a small brush of
+	// cells around it, or deposits ks of the excess (and fills the pits it runs into). Its water
+	// evaporates by ke over its whole life, and it leaves what it still carries where it stops.
+	// A step drops dropletsPerCell droplets per cell at deterministic places, buckets them into
+	// square tiles and runs the tiles in 4 passes, a checkerboard colour each. The tiles are more
+	// than two droplet paths across, so droplets of tiles of the same colour never touch the same
+	// cells and run in parallel, while each tile runs its droplets in order: the result is the
+	// same for any number of threads.
+	// The buckets are kept between steps, so steps on the same map don't allocate.
+	class DropletErosion {
+	public:
+		// where a droplet lands
+		struct Start {
+			float x, y;
+		};
+
+		// one batch of droplets over the interior of the height map, the border is never written
+		void step(HeightfieldView heightMap, const ErosionParams& params, ThreadPool& pool = ThreadPool::shared());
+
+		// starts the sequence of droplet positions again
+		void reset() { m_batch = 0; }
+
+	private:
+		std::uint64_t m_batch = 0;
+		std::vector<Start> m_starts; // bucketed by tile
+		std::vector<int> m_tileStarts; // first droplet of each tile, one past the end last
+		std::vector<int> m_tileEnds; // where the next droplet of each tile goes while bucketing
+		std::vector<int> m_tiles; // the tiles of one colour
+	};
+}
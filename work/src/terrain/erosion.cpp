@@ -0,0 +1,414 @@
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "erosion.hpp"
+
+
+using namespace glm;
+
+namespace terrain {
+
+	namespace {
+
+		const int rowsPerBand = 16;
+		const int traversalTile = 128;
+
+
+		//calls fn(x, y) for every interior cell, in the order of the traversal
+		template <typename Fn>
+		void forEachCellInOrder(int width, int height, ErosionTraversal traversal, Fn fn) {
+			if (traversal == ErosionTraversal::Columns) {
+				for (int x = 0; x < width; x++) {
+					for (int y = 0; y < height; y++) {
+						fn(x, y);
+					}
+				}
+				return;
+			}
+
+			for (int ty = 0; ty < height; ty += traversalTile) {
+				for (int tx = 0; tx < width; tx += traversalTile) {
+					int yEnd = std::min(ty + traversalTile, height);
+					int xEnd = std::min(tx + traversalTile, width);
+					for (int y = ty; y < yEnd; y++) {
+						for (int x = tx; x < xEnd; x++) {
+							fn(x, y);
+						}
+					}
+				}
+			}
+		}
+
+		//calls fn(x, y) for every interior cell of an in-place sweep. Coloured updates go through
+		//the 9 colours of (x % 3, y % 3) in turn. fn changes the 3x3 cells around (x, y), and those
+		//of two cells of the same colour never overlap, so each colour runs in row bands on the pool.
+		//Otherwise the cells are visited serially in the order of the traversal
+		template <typename Fn>
+		void sweep(int width, int height, const ErosionParams& params, ThreadPool& pool, Fn fn) {
+			if (params.thermalUpdate != ErosionUpdate::Coloured) {
+				forEachCellInOrder(width, height, params.traversal, fn);
+				return;
+			}
+
+			for (int colour = 0; colour < 9; colour++) {
+				int firstX = colour % 3, firstY = colour / 3;
+				int rows = (height - firstY + 2) / 3;
+				pool.parallelFor(0, rows, rowsPerBand, [&](int begin, int end) {
+					for (int row = begin; row < end; row++) {
+						int y = firstY + 3 * row;
+						for (int x = firstX; x < width; x += 3) {
+							fn(x, y);
+						}
+					}
+				});
+			}
+		}
+
+
+		//moves material from (x, y) to its steepest downhill neighbour if the slope is below the talus threshold
+		void terraceErosion(HeightfieldView heightMap, int x, int y, const ErosionParams& params) {
+
+			//get neightbor with steapest slope
+			float dmax = 0;
+			ivec2 neigh = ivec2(0, 0);
+			for (int i = -1; i <= 1; i++) {
+				for (int j = -1; j <= 1; j++) {
+
+					float d = heightMap(x, y) - heightMap(x + i, y + j);
+					if (d > dmax) {
+						dmax = d;
+						neigh = ivec2(x + i, y + j);
+					}
+
+				}
+			}
+
+			//erode point (move material down the slope)
+			if (dmax > 0 && dmax <= params.talusThreshold) {
+				float deltaH = 0.3 * dmax;
+				heightMap(x, y) -= deltaH;
+				heightMap(neigh.x, neigh.y) += deltaH;
+			}
+		}
+
+
+		//moves material from (x, y) to every neighbour that is more than the talus threshold lower
+		void thermalErosion(HeightfieldView heightMap, int x, int y, const ErosionParams& params) {
+
+			float totalDiff = 0;
+			float diffMax = 0;
+			for (int i = -1; i <= 1; i++) {
+				for (int j = -1; j <= 1; j++) {
+					float diff = heightMap(x, y) - heightMap(x + i, y + j);
+					if (diff > diffMax) {
+						diffMax = diff;
+					}
+					if(diff > params.talusThreshold)
+						totalDiff += diff;
+				}
+			}
+			if (totalDiff > 0) {
+				float initialHeight = heightMap(x, y);
+				for (int i = -1; i <= 1; i++) {
+					for (int j = -1; j <= 1; j++) {
+						float diff = initialHeight - heightMap(x + i, y + j);
+						if (diff > params.talusThreshold) {
+							float moveAmount = params.sedimentvolume*(diffMax - params.talusThreshold)*(diff/totalDiff);
+							heightMap(x, y) -= moveAmount;
+							heightMap(x + i, y + j) += moveAmount;
+						}
+					}
+				}
+			}
+		}
+
+
+		//rains on (x, y), dissolves terrain into the water, moves water and sediment to lower
+		//neighbours then evaporates and deposits what the remaining water can't carry
+		void hydraulicErosion(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, int x, int y, const ErosionParams& params) {
+
+			//add water (rain)
+			waterVolume(x, y) += params.kr;
+
+
+			//erode terrain (disolve sediment into water)
+			float erodeAmount = waterVolume(x, y) * params.ks;
+			heightMap(x, y) -= erodeAmount;
+			sedimentVolume(x, y) += erodeAmount;
+
+
+			//transport water with sediment in it
+			float totalDiff = 0;
+			for (int i = -1; i <= 1; i++) {
+				for (int j = -1; j <= 1; j++) {
+					float diff = fmax(0.0f, (heightMap(x, y) + waterVolume(x, y)) - (heightMap(x + i, y + j) + waterVolume(x + i, y + j)));
+					totalDiff += diff;
+				}
+			}
+			if (totalDiff > 0) {
+				float totalWaterMoveAmount = fmax(0.0f, fmin(waterVolume(x, y), totalDiff / 2.0f));
+				float initialWaterVolume = waterVolume(x, y);
+				float initialsedimentVolume = sedimentVolume(x, y);
+				for (int i = -1; i <= 1; i++) {
+					for (int j = -1; j <= 1; j++) {
+						float diff = fmax(0.0f, (heightMap(x, y) + initialWaterVolume) - (heightMap(x + i, y + j) + waterVolume(x + i, y + j)));
+						float waterMoveAmount = (diff / totalDiff) * totalWaterMoveAmount;
+						float moveSedimentAmount = (waterMoveAmount / initialWaterVolume) * initialsedimentVolume;
+						waterVolume(x, y) -= waterMoveAmount;
+						sedimentVolume(x, y) -= moveSedimentAmount;
+						waterVolume(x + i, y + j) += waterMoveAmount;
+						sedimentVolume(x + i, y + j) += moveSedimentAmount;
+
+						if (waterVolume(x, y) < 0) waterVolume(x, y) = 0;
+						if (sedimentVolume(x, y) < 0) sedimentVolume(x, y) = 0;
+					}
+				}
+			}
+
+
+			//evaporte water
+			waterVolume(x, y) *= 1 - params.ke;
+			if (waterVolume(x, y) < 0.0001) {
+				waterVolume(x, y) = 0;
+			}
+
+
+			//deposit sediment
+			float maxSediment = waterVolume(x, y) * params.kc;
+			float depositAmount = fmax(0.0f, sedimentVolume(x, y) - maxSediment);
+			sedimentVolume(x, y) -= depositAmount;
+			heightMap(x, y) += depositAmount;
+		}
+
+
+		//calls fn(x, y, edge) for every cell of the height map and its border, in row bands. Border
+		//cells (edge) never erode but still receive material, like the in place sweeps. edge is a
+		//std::true_type or std::false_type so the checks for it drop out of the interior
+		template <typename Fn>
+		void forEachWithBorder(int width, int height, ThreadPool& pool, Fn fn) {
+			pool.parallelFor(-1, height + 1, rowsPerBand, [&](int yBegin, int yEnd) {
+				for (int y = yBegin; y < yEnd; y++) {
+					if (y < 0 || y >= height) {
+						for (int x = -1; x <= width; x++) fn(x, y, std::true_type());
+						continue;
+					}
+					fn(-1, y, std::true_type());
+					for (int x = 0; x < width; x++) fn(x, y, std::false_type());
+					fn(width, y, std::true_type());
+				}
+			});
+		}
+
+
+		//(re)allocates field for a map of width x height if it has another size, keeping the
+		//border at 0
+		void resize(Heightfield& field, int width, int height) {
+			if (field.width() != width || field.height() != height || field.border() < 1) {
+				field = Heightfield(width, height, 1);
+			}
+		}
+
+		//sets the interior and the one cell border of field to 0
+		void clearWithBorder(HeightfieldView field) {
+			for (int y = -1; y <= field.height; y++) {
+				std::fill(field.row(y) - 1, field.row(y) + field.width + 1, 0.0f);
+			}
+		}
+
+
+		//Jacobi terrace erosion: every cell moves its share to its steepest downhill neighbour, all
+		//worked out from the heights before the step. Same rule as terraceErosion
+		void terraceErosionJacobi(HeightfieldView heightMap, const ErosionParams& params, ErosionState& state, ThreadPool& pool) {
+			const int width = heightMap.width;
+			const int height = heightMap.height;
+
+			//what each cell sends (0 on the border) and to which of its neighbours, as an index into
+			//the 3x3 stencil. targets has a border as well (pointing at the cell itself, 4) so the
+			//gather below doesn't need to branch on anything
+			resize(state.amounts, width, height);
+			Heightfield& amounts = state.amounts;
+			const int targetStride = width + 2;
+			std::vector<std::uint8_t>& targets = state.targets;
+			targets.assign(size_t(targetStride) * (height + 2), 4);
+			auto target = [&](int x, int y) -> std::uint8_t& { return targets[size_t(y + 1) * targetStride + x + 1]; };
+			pool.parallelFor(0, height, rowsPerBand, [&](int yBegin, int yEnd) {
+				for (int y = yBegin; y < yEnd; y++) {
+					for (int x = 0; x < width; x++) {
+						float dmax = 0;
+						int steepest = 4;
+						for (int i = -1; i <= 1; i++) {
+							for (int j = -1; j <= 1; j++) {
+								float d = heightMap(x, y) - heightMap(x + i, y + j);
+								if (d > dmax) {
+									dmax = d;
+									steepest = (i + 1) * 3 + (j + 1);
+								}
+							}
+						}
+						bool erodes = dmax > 0 && dmax <= params.talusThreshold;
+						amounts(x, y) = erodes ? float(0.3 * dmax) : 0;
+						target(x, y) = std::uint8_t(steepest);
+					}
+				}
+			});
+
+			//each cell gathers from the neighbours that picked it. It only reads its own height, so
+			//it can write the new one in place
+			forEachWithBorder(width, height, pool, [&](int x, int y, auto edge) {
+				float h = heightMap(x, y) - (edge ? 0 : amounts(x, y));
+				for (int i = -1; i <= 1; i++) {
+					for (int j = -1; j <= 1; j++) {
+						int nx = x + i, ny = y + j;
+						if (edge && (nx < 0 || nx >= width || ny < 0 || ny >= height)) continue;
+						if (i == 0 && j == 0) continue;
+						//the neighbour at (i, j) sends to us if its target is (-i, -j)
+						h += target(nx, ny) == (1 - i) * 3 + (1 - j) ? amounts(nx, ny) : 0.0f;
+					}
+				}
+				heightMap(x, y) = h;
+			});
+		}
+
+
+		//Jacobi thermal erosion: every cell sends material to each neighbour more than the talus
+		//threshold lower, in proportion to the difference, all worked out from the heights before
+		//the step. Same rule as thermalErosion
+		void thermalErosionJacobi(HeightfieldView result, const ErosionParams& params, ErosionState& state, ThreadPool& pool) {
+			const int width = result.width;
+			const int height = result.height;
+
+			//the gather reads the neighbours' heights, so it works from a copy of the heights
+			resize(state.heights, width, height);
+			const Heightfield& heightMap = state.heights;
+			for (int y = -1; y <= height; y++) {
+				std::copy(result.row(y) - 1, result.row(y) + width + 1, state.heights.row(y) - 1);
+			}
+
+			//the share of each unit of height difference that a cell sends, 0 on the border
+			resize(state.amounts, width, height);
+			Heightfield& rates = state.amounts;
+			pool.parallelFor(0, height, rowsPerBand, [&](int yBegin, int yEnd) {
+				for (int y = yBegin; y < yEnd; y++) {
+					for (int x = 0; x < width; x++) {
+						float totalDiff = 0;
+						float diffMax = 0;
+						for (int i = -1; i <= 1; i++) {
+							for (int j = -1; j <= 1; j++) {
+								float diff = heightMap(x, y) - heightMap(x + i, y + j);
+								if (diff > diffMax) diffMax = diff;
+								if (diff > params.talusThreshold) totalDiff += diff;
+							}
+						}
+						rates(x, y) = totalDiff > 0 ? params.sedimentvolume * (diffMax - params.talusThreshold) / totalDiff : 0;
+					}
+				}
+			});
+
+			//each cell loses what it sends and gains what its higher neighbours send
+			forEachWithBorder(width, height, pool, [&](int x, int y, auto edge) {
+				float h = heightMap(x, y);
+				float rate = edge ? 0 : rates(x, y);
+				for (int i = -1; i <= 1; i++) {
+					for (int j = -1; j <= 1; j++) {
+						int nx = x + i, ny = y + j;
+						if (edge && (nx < 0 || nx >= width || ny < 0 || ny >= height)) continue;
+						float diff = heightMap(x, y) - heightMap(nx, ny);
+						if (diff > params.talusThreshold) {
+							h -= rate * diff;
+						}
+						else if (-diff > params.talusThreshold) {
+							h += rates(nx, ny) * -diff;
+						}
+					}
+				}
+				result(x, y) = h;
+			});
+		}
+	}
+
+
+	void erodeTerrainTerraces(HeightfieldView heightMap, const ErosionParams& params, ErosionState& state, ThreadPool& pool) {
+		if (params.thermalUpdate == ErosionUpdate::Jacobi) {
+			terraceErosionJacobi(heightMap, params, state, pool);
+			return;
+		}
+
+		//the border is read by the stencil but never eroded itself
+		sweep(heightMap.width, heightMap.height, params, pool, [&](int x, int y) {
+			terraceErosion(heightMap, x, y, params);
+		});
+	}
+
+
+	void erodeTerrainRealistic(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, const ErosionParams& params,
+		ErosionState& state, ThreadPool& pool) {
+
+		if (params.hydraulic != HydraulicModel::Cells) {
+			if (params.thermalUpdate == ErosionUpdate::Jacobi) {
+				thermalErosionJacobi(heightMap, params, state, pool);
+			}
+			else {
+				sweep(heightMap.width, heightMap.height, params, pool, [&](int x, int y) {
+					thermalErosion(heightMap, x, y, params);
+				});
+			}
+			if (params.hydraulic == HydraulicModel::Pipes) {
+				state.pipes.step(heightMap, waterVolume, sedimentVolume, params, pool);
+			}
+			else {
+				state.droplets.step(heightMap, params, pool);
+			}
+			return;
+		}
+
+		if (params.thermalUpdate == ErosionUpdate::Jacobi) {
+			thermalErosionJacobi(heightMap, params, state, pool);
+			forEachCellInOrder(heightMap.width, heightMap.height, params.traversal, [&](int x, int y) {
+				hydraulicErosion(heightMap, waterVolume, sedimentVolume, x, y, params);
+			});
+			return;
+		}
+
+		//the border is read by the stencil but never eroded itself
+		sweep(heightMap.width, heightMap.height, params, pool, [&](int x, int y) {
+			thermalErosion(heightMap, x, y, params);
+			hydraulicErosion(heightMap, waterVolume, sedimentVolume, x, y, params);
+		});
+	}
+
+
+	void erodeTerrainIteration(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, const ErosionParams& params,
+		int iteration, int iterations, ErosionState& state, ThreadPool& pool) {
+		if (params.type == ErosionType::Terraces) {
+			erodeTerrainTerraces(heightMap, params, state, pool);
+		}
+		else {
+			erodeTerrainRealistic(heightMap, waterVolume, sedimentVolume, params, state, pool);
+		}
+
+		//as the interactive erosion always has, the last iteration starts from dry land
+		if (iteration + 1 == iterations - 1) {
+			clearWithBorder(waterVolume);
+			clearWithBorder(sedimentVolume);
+			state.reset();
+		}
+	}
+
+
+	void erodeTerrain(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, const ErosionParams& params,
+		int iterations, ThreadPool& pool) {
+		ErosionState state;
+		for (int i = 0; i < iterations; i++) {
+			erodeTerrainIteration(heightMap, waterVolume, sedimentVolume, params, i, iterations, state, pool);
+		}
+	}
+}
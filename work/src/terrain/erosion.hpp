@@ -0,0 +1,124 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <vector>
+
+// project
+#include "droplet_erosion.hpp"
+#include "heightfield.hpp"
+#include "pipe_erosion.hpp"
+#include "thread_pool.hpp"
+
+namespace terrain {
+
+	enum class ErosionType : int {
+		Terraces = 0,
+		Realistic = 1	// thermal + hydraulic
+	};
+
+	// How the thermal (and terrace) step updates the height map.
+	// InPlace sweeps the grid serially and every cell sees the changes of the cells before it, so
+	// the result depends on the traversal order. Jacobi works out every cell's outflow from the
+	// heights before the step and writes a new buffer, so it runs in row bands on a thread pool and
+	// gives the same result for any number of threads.
+	// Coloured is in place too (Gauss-Seidel), in 9 passes of the cells with the same (x % 3, y % 3).
+	// The stencils change the 3x3 cells around a cell, which never overlap within a pass, so each
+	// pass runs in parallel and the result is the same for any number of threads. The cell
+	// hydraulic model runs in the same passes, right after the thermal step of each cell.
+	enum class ErosionUpdate : int {
+		InPlace = 0,
+		Jacobi = 1,
+		Coloured = 2
+	};
+
+	// Order in which the serial in-place sweeps (terraces, in place thermal and the cell hydraulic
+	// model) visit the cells. Every cell is changed in turn and sees the changes of the cells
+	// before it, so the order changes the result.
+	// Tiled goes through 128 x 128 tiles in row-major order, and row by row within each, so the
+	// 3x3 stencils only touch the rows of the tile and a one cell halo around it.
+	// Columns is the original order, x outer and y inner, which walks down the columns of the
+	// row-major fields. It is kept to reproduce earlier results.
+	enum class ErosionTraversal : int {
+		Columns = 0,
+		Tiled = 1
+	};
+
+	// How the hydraulic step moves water and sediment.
+	// Cells moves them from each cell to its lower neighbours, in place and in order.
+	// Pipes is the shallow water model of PipeErosion, which keeps the flow between iterations.
+	// Droplets runs batches of rain droplets down the terrain (DropletErosion), they carry their
+	// own water and sediment, so the water and sediment volumes aren't used.
+	enum class HydraulicModel : int {
+		Cells = 0,
+		Pipes = 1,
+		Droplets = 2
+	};
+
+	struct ErosionParams {
+		ErosionType type = ErosionType::Realistic;
+
+		//thermal erosion
+		float talusThreshold = 1.0f;
+		float sedimentvolume = 0.05f;
+		ErosionUpdate thermalUpdate = ErosionUpdate::InPlace;
+		ErosionTraversal traversal = ErosionTraversal::Tiled;	// of the in-place sweeps
+
+		//hydraulic erosion
+		HydraulicModel hydraulic = HydraulicModel::Cells;
+		float kr = 0.1f;	// rain
+		float ks = 0.1f;	// dissolve
+		float ke = 0.5f;	// evaporation
+		float kc = 0.1f;	// sediment capacity
+
+		//droplet erosion, with ks, ke and kc above
+		float dropletsPerCell = 0.25f;	// droplets per iteration for each cell of the map
+		int dropletLifetime = 30;	// most cells a droplet runs through
+	};
+
+
+	// What an erosion carries from one iteration to the next besides the height map and the water
+	// and sediment volumes: the flow of the pipe model, the place in the droplet sequence and the
+	// scratch fields of the Jacobi updates. They are only reallocated when the size of the map
+	// changes, so iterations on the same map don't allocate.
+	struct ErosionState {
+		PipeErosion pipes;
+		DropletErosion droplets;
+		Heightfield heights;	// the heights before a Jacobi thermal step
+		Heightfield amounts;	// what each cell sends in a Jacobi step
+		std::vector<std::uint8_t> targets;	// which neighbour each cell sends to in a Jacobi terrace step
+
+		// for starting again from still water (and the first batch of droplets)
+		void reset() {
+			pipes.reset();
+			droplets.reset();
+		}
+	};
+
+
+	// The erosions work in place on fields owned by the caller, which need a border of at least
+	// one cell. The border is only read (and given material by the cells next to it), it acts as
+	// a fixed boundary.
+
+	// One iteration of terrace forming erosion over the interior of the height map.
+	void erodeTerrainTerraces(HeightfieldView heightMap, const ErosionParams& params, ErosionState& state,
+		ThreadPool& pool = ThreadPool::shared());
+
+	// One iteration of thermal + hydraulic erosion over the interior of the height map.
+	// waterVolume and sedimentVolume must have the same size as the height map and carry over
+	// between iterations, like state. With Jacobi updates the thermal step runs over the whole map
+	// before the (always serial) hydraulic sweep, instead of the two alternating per cell. So it
+	// does with the pipe and droplet models.
+	void erodeTerrainRealistic(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, const ErosionParams& params,
+		ErosionState& state, ThreadPool& pool = ThreadPool::shared());
+
+	// Iteration number iteration (from 0) of a whole erosion of the given number of iterations:
+	// one iteration of the erosion type, then the water, sediment and state are cleared before
+	// the last iteration.
+	void erodeTerrainIteration(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, const ErosionParams& params,
+		int iteration, int iterations, ErosionState& state, ThreadPool& pool = ThreadPool::shared());
+
+	// Runs a whole erosion with the same schedule as the interactive one in ErosionSimulation.
+	void erodeTerrain(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, const ErosionParams& params,
+		int iterations, ThreadPool& pool = ThreadPool::shared());
+}
@@ -0,0 +1,120 @@
+// project
+#include "erosion_simulation.hpp"
+
+
+namespace terrain {
+
+	ErosionSimulation::ErosionSimulation(ThreadPool& pool)
+		: m_pool(pool), m_thread([this] { simulationLoop(); }) { }
+
+	ErosionSimulation::~ErosionSimulation() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+			m_cancelled = true;
+		}
+		m_changed.notify_all();
+		m_thread.join();
+	}
+
+
+	void ErosionSimulation::start(const Heightfield& heightMap, const ErosionParams& params, int iterations) {
+		m_run++;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_startHeights = heightMap;
+			m_startParams = params;
+			m_startIterations = iterations;
+			m_startRun = m_run;
+			m_starting = true;
+			m_cancelled = true; // the run before this one
+			m_paused = false;
+			m_running = true;
+			m_progress = 0;
+			m_iterations = iterations;
+		}
+		m_changed.notify_all();
+	}
+
+	void ErosionSimulation::cancel() {
+		m_run++;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_starting = false;
+			m_cancelled = true;
+			m_running = false;
+		}
+		m_changed.notify_all();
+	}
+
+	void ErosionSimulation::pause(bool paused) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_paused = paused;
+		}
+		m_changed.notify_all();
+	}
+
+	bool ErosionSimulation::poll() {
+		return m_snapshots.update() && m_snapshots.front().run == m_run;
+	}
+
+
+	void ErosionSimulation::simulationLoop() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			m_changed.wait(lock, [this] { return m_stopping || m_starting; });
+			if (m_stopping) return;
+
+			m_starting = false;
+			m_cancelled = false;
+			const int run = m_startRun;
+			const int iterations = m_startIterations;
+			const ErosionParams params = m_startParams;
+			m_heightMap = m_startHeights;
+			lock.unlock();
+
+			//the working fields are only reallocated when the size changes
+			if (m_waterVolume.sameShape(m_heightMap)) {
+				m_waterVolume.fill(0);
+				m_sedimentVolume.fill(0);
+			}
+			else {
+				m_waterVolume = Heightfield(m_heightMap.width(), m_heightMap.height(), m_heightMap.border());
+				m_sedimentVolume = Heightfield(m_heightMap.width(), m_heightMap.height(), m_heightMap.border());
+			}
+			m_state.reset();
+
+			for (int i = 0; i < iterations && !m_cancelled; i++) {
+				if (m_paused) {
+					lock.lock();
+					m_changed.wait(lock, [this] { return !m_paused || m_cancelled; });
+					lock.unlock();
+					if (m_cancelled) break;
+				}
+
+				erodeTerrainIteration(m_heightMap.view(), m_waterVolume.view(), m_sedimentVolume.view(), params, i, iterations, m_state, m_pool);
+				publish(i + 1, run);
+
+				//under the lock, so it never overwrites the reset of a start() that came in since the check
+				lock.lock();
+				if (!m_cancelled) m_progress = i + 1;
+				lock.unlock();
+			}
+
+			lock.lock();
+			if (!m_starting) m_running = false;
+		}
+	}
+
+	void ErosionSimulation::publish(int iteration, int run) {
+		//copying into the same shape reuses the snapshot's fields
+		Snapshot& snapshot = m_snapshots.back();
+		snapshot.heightMap = m_heightMap;
+		snapshot.waterVolume = m_waterVolume;
+		snapshot.sedimentVolume = m_sedimentVolume;
+		snapshot.iteration = iteration;
+		snapshot.run = run;
+		m_snapshots.publish();
+	}
+}
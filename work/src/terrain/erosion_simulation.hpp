@@ -0,0 +1,99 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// project
+#include "erosion.hpp"
+#include "heightfield.hpp"
+#include "thread_pool.hpp"
+#include "triple_buffer.hpp"
+
+namespace terrain {
+
+	// Runs an erosion on its own thread, as fast as it goes, instead of an iteration per frame.
+	// After every iteration it publishes a copy of the height map, water and sediment through a
+	// triple buffer, which the render thread picks up with poll() without waiting on the
+	// simulation. The erosion can be paused and cancelled between iterations.
+	// The iterations run their passes on the pool like erodeTerrain, and each run follows the same
+	// schedule (erodeTerrainIteration). Once its fields are allocated, neither side allocates per
+	// iteration. start(), cancel() and poll() are for one (render) thread, the rest for any.
+	class ErosionSimulation {
+	public:
+		// the fields after some iterations of a run
+		struct Snapshot {
+			Heightfield heightMap;
+			Heightfield waterVolume;
+			Heightfield sedimentVolume;
+			int iteration = 0; // iterations done
+			int run = 0; // start() that made it
+		};
+
+		explicit ErosionSimulation(ThreadPool& pool = ThreadPool::shared());
+		~ErosionSimulation();
+
+		ErosionSimulation(const ErosionSimulation&) = delete;
+		ErosionSimulation& operator=(const ErosionSimulation&) = delete;
+
+		// Cancels the current run and starts eroding a copy of heightMap (which needs a border) from
+		// dry land. The settings are copied too, so the GUI can change its own while it runs.
+		// Doesn't wait for the current iteration to finish, the new run starts after it.
+		void start(const Heightfield& heightMap, const ErosionParams& params, int iterations);
+
+		// stops the run after its current iteration, snapshots it still publishes are dropped
+		void cancel();
+
+		// holds the run between iterations until resumed
+		void pause(bool paused);
+		bool paused() const { return m_paused; }
+
+		// true from start() until the run has done its iterations or is cancelled
+		bool running() const { return m_running; }
+
+		// iterations done by the current run, which may be ahead of the last snapshot polled
+		int progress() const { return m_progress; }
+		int iterations() const { return m_iterations; }
+
+		// Render thread: moves to the newest snapshot of the current run, returns false if there
+		// is none since the last call. latest() is then that snapshot until the next poll().
+		bool poll();
+		const Snapshot& latest() const { return m_snapshots.front(); }
+
+	private:
+		ThreadPool& m_pool;
+
+		// the run waiting to start, under m_mutex
+		Heightfield m_startHeights;
+		ErosionParams m_startParams;
+		int m_startIterations = 0;
+		int m_startRun = 0;
+		bool m_starting = false;
+		bool m_stopping = false;
+		std::mutex m_mutex;
+		std::condition_variable m_changed;
+
+		int m_run = 0; // of the render thread, snapshots of older runs are ignored
+		std::atomic<bool> m_cancelled{ false };
+		std::atomic<bool> m_paused{ false };
+		std::atomic<bool> m_running{ false };
+		std::atomic<int> m_progress{ 0 };
+		std::atomic<int> m_iterations{ 0 };
+
+		// only the simulation thread uses these
+		Heightfield m_heightMap;
+		Heightfield m_waterVolume;
+		Heightfield m_sedimentVolume;
+		ErosionState m_state;
+
+		TripleBuffer<Snapshot> m_snapshots;
+
+		// declared last so everything above exists before the thread starts
+		std::thread m_thread;
+
+		void simulationLoop();
+		void publish(int iteration, int run);
+	};
+}
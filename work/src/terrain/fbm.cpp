@@ -0,0 +1,282 @@
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+// project
+#include "fbm.hpp"
+
+
+namespace terrain {
+
+	OctaveTable::OctaveTable(const FractalParams& params) {
+		assert(params.numOctaves >= 0 && params.numOctaves <= maxOctaves);
+		numOctaves = std::max(0, std::min(params.numOctaves, maxOctaves));
+		for (int i = 0; i < numOctaves; i++) {
+			frequency[i] = std::pow(params.frequencyMultiplier, i);
+			if (params.type == FractalType::HybridMultifractal) {
+				amptitude[i] = std::pow(std::pow(params.amtitudeMultiplier, i), params.H);
+			}
+			else {
+				amptitude[i] = std::pow(params.amtitudeMultiplier, i);
+			}
+		}
+	}
+
+
+	namespace {
+		// samples are processed in blocks of this size so the scratch arrays live on the stack
+		constexpr int blockSize = 128;
+
+		// Adds one octave of raw noise (and its gradient) to the running fractal value and updates the
+		// per-sample weights the heterogeneous and hybrid types carry between octaves.
+		// Shared by direct evaluation and recombining cached octaves, so both give identical results.
+		template <FractalType Type, bool Derivatives>
+		inline void accumulateOctave(const FractalParams& params, double octaveAmptitude, float chain,
+			const float* noise, const float* noiseDx, const float* noiseDy,
+			float* out, float* outDx, float* outDy, float* weight, float* weightDx, float* weightDy, int n) {
+
+			if constexpr (Type == FractalType::Homogeneous) {
+				//add multiple octaves (frequencies that are double the last frequancy and half the amptitude) together to make rough terrain.
+				const float amptitude = float(octaveAmptitude);
+				for (int k = 0; k < n; k++) {
+					out[k] += noise[k] * amptitude;
+				}
+				if (Derivatives) {
+					for (int k = 0; k < n; k++) {
+						outDx[k] += noiseDx[k] * chain * amptitude;
+						outDy[k] += noiseDy[k] * chain * amptitude;
+					}
+				}
+			}
+			else if constexpr (Type == FractalType::Heterogeneous) {
+				//weight the amptitude of each frequqncy by the current height of the function to smooth out valleys.
+				//noise is moved to [0..1] so adding octaves increases the height of mountains instead of just the roughness.
+				const float amptitude = float(octaveAmptitude);
+				for (int k = 0; k < n; k++) {
+					float value = (noise[k] + 1) / 2.0f * amptitude;
+					if (Derivatives) {
+						float valueDx = noiseDx[k] * chain * 0.5f * amptitude;
+						float valueDy = noiseDy[k] * chain * 0.5f * amptitude;
+						outDx[k] += valueDx * weight[k] + value * weightDx[k];
+						outDy[k] += valueDy * weight[k] + value * weightDy[k];
+					}
+					out[k] += value * weight[k];
+					weight[k] = std::min(1.0f, out[k]);
+					if (Derivatives) {
+						bool clamped = out[k] >= 1.0f;
+						weightDx[k] = clamped ? 0.0f : outDx[k];
+						weightDy[k] = clamped ? 0.0f : outDy[k];
+					}
+				}
+			}
+			else {
+				//scale each octave by the previous one
+				const double amptitude = octaveAmptitude;
+				const float offset = params.offset;
+				for (int k = 0; k < n; k++) {
+					float value = float((noise[k] + offset) * amptitude);
+					float scaledNoise = value * weight[k];
+					out[k] += scaledNoise;
+					if (Derivatives) {
+						float scaledDx = float(noiseDx[k] * chain * amptitude) * weight[k] + value * weightDx[k];
+						float scaledDy = float(noiseDy[k] * chain * amptitude) * weight[k] + value * weightDy[k];
+						outDx[k] += scaledDx;
+						outDy[k] += scaledDy;
+						bool clamped = scaledNoise >= 1.0f;
+						weightDx[k] = clamped ? 0.0f : scaledDx;
+						weightDy[k] = clamped ? 0.0f : scaledDy;
+					}
+					weight[k] = std::min(1.0f, scaledNoise);
+				}
+			}
+		}
+
+
+		// Evaluates one block of at most blockSize samples.
+		// Octaves == 0 means the octave count is only known at runtime (octaves.numOctaves).
+		// With Derivatives the analytic gradient of the fractal is written to outDx/outDy, using
+		// the chain rule through the octave frequencies and the running weights.
+		template <FractalType Type, int Octaves, bool Derivatives>
+		void fbmBlock(const PermutationTable& perm, const FractalParams& params, const OctaveTable& octaves,
+			const float* xs, const float* ys, float* out, float* outDx, float* outDy, int n) {
+
+			const int numOctaves = Octaves > 0 ? Octaves : octaves.numOctaves;
+
+			float baseX[blockSize], baseY[blockSize];
+			float octaveX[blockSize] = {}, octaveY[blockSize] = {}; // zeroed, -Wmaybe-uninitialized can't see n <= blockSize
+			float noise[blockSize], weight[blockSize];
+
+			// derivative state, only touched when Derivatives is set
+			float noiseDx[blockSize], noiseDy[blockSize];
+			float weightDx[blockSize], weightDy[blockSize];
+
+			for (int k = 0; k < n; k++) {
+				baseX[k] = xs[k] * params.baseFrequency;
+				baseY[k] = ys[k] * params.baseFrequency;
+				out[k] = 0.0f;
+				weight[k] = 1.0f;
+			}
+			if (Derivatives) {
+				for (int k = 0; k < n; k++) {
+					outDx[k] = outDy[k] = 0.0f;
+					weightDx[k] = weightDy[k] = 0.0f;
+				}
+			}
+
+			for (int i = 0; i < numOctaves; i++) {
+				const double frequency = octaves.frequency[i];
+				for (int k = 0; k < n; k++) {
+					octaveX[k] = float(baseX[k] * frequency);
+					octaveY[k] = float(baseY[k] * frequency);
+				}
+				if (Derivatives) {
+					noiseBatch(params.basis, perm, octaveX, octaveY, noise, noiseDx, noiseDy, n);
+				}
+				else {
+					noiseBatch(params.basis, perm, octaveX, octaveY, noise, n);
+				}
+
+				// d(octave coordinate) / d(sample coordinate)
+				const float chain = float(params.baseFrequency * frequency);
+				accumulateOctave<Type, Derivatives>(params, octaves.amptitude[i], chain, noise, noiseDx, noiseDy,
+					out, outDx, outDy, weight, weightDx, weightDy, n);
+			}
+		}
+
+
+		template <FractalType Type, int Octaves, bool Derivatives>
+		void fbmKernel(const PermutationTable& perm, const FractalParams& params, const OctaveTable& octaves,
+			const float* xs, const float* ys, float* out, float* outDx, float* outDy, int n) {
+			for (int start = 0; start < n; start += blockSize) {
+				int count = std::min(blockSize, n - start);
+				if (Derivatives) {
+					fbmBlock<Type, Octaves, true>(perm, params, octaves, xs + start, ys + start, out + start, outDx + start, outDy + start, count);
+				}
+				else {
+					fbmBlock<Type, Octaves, false>(perm, params, octaves, xs + start, ys + start, out + start, nullptr, nullptr, count);
+				}
+			}
+		}
+
+
+		// combines cached octaves for one block of at most blockSize samples, the same way fbmBlock does
+		template <FractalType Type, bool Derivatives>
+		void combineBlock(const FractalParams& params, const OctaveTable& octaves, int offset,
+			const float* const* noise, const float* const* noiseDx, const float* const* noiseDy,
+			float* out, float* outDx, float* outDy, int n) {
+
+			float weight[blockSize], weightDx[blockSize], weightDy[blockSize];
+			for (int k = 0; k < n; k++) {
+				out[k] = 0.0f;
+				weight[k] = 1.0f;
+			}
+			if (Derivatives) {
+				for (int k = 0; k < n; k++) {
+					outDx[k] = outDy[k] = 0.0f;
+					weightDx[k] = weightDy[k] = 0.0f;
+				}
+			}
+
+			for (int i = 0; i < octaves.numOctaves; i++) {
+				const float chain = float(params.baseFrequency * octaves.frequency[i]);
+				accumulateOctave<Type, Derivatives>(params, octaves.amptitude[i], chain,
+					noise[i] + offset, Derivatives ? noiseDx[i] + offset : nullptr, Derivatives ? noiseDy[i] + offset : nullptr,
+					out, outDx, outDy, weight, weightDx, weightDy, n);
+			}
+		}
+
+		template <FractalType Type, bool Derivatives>
+		void combineOctaves(const FractalParams& params, const OctaveTable& octaves,
+			const float* const* noise, const float* const* noiseDx, const float* const* noiseDy,
+			float* out, float* outDx, float* outDy, int n) {
+			for (int start = 0; start < n; start += blockSize) {
+				int count = std::min(blockSize, n - start);
+				combineBlock<Type, Derivatives>(params, octaves, start, noise, noiseDx, noiseDy,
+					out + start, Derivatives ? outDx + start : nullptr, Derivatives ? outDy + start : nullptr, count);
+			}
+		}
+
+
+		// table of kernels specialised for 1 to maxSpecialisedOctaves octaves (index 0 is the runtime count version)
+		constexpr int maxSpecialisedOctaves = 10;
+
+		template <FractalType Type, bool Derivatives, int... Octaves>
+		Fbm::Kernel selectKernel(int numOctaves, std::integer_sequence<int, Octaves...>) {
+			static const Fbm::Kernel kernels[] = { fbmKernel<Type, Octaves, Derivatives>... };
+			if (numOctaves > 0 && numOctaves <= maxSpecialisedOctaves) {
+				return kernels[numOctaves];
+			}
+			return kernels[0];
+		}
+
+		template <bool Derivatives>
+		Fbm::Kernel selectKernel(FractalType type, int numOctaves) {
+			auto octaveCounts = std::make_integer_sequence<int, maxSpecialisedOctaves + 1>();
+			switch (type) {
+			case FractalType::Homogeneous: return selectKernel<FractalType::Homogeneous, Derivatives>(numOctaves, octaveCounts);
+			case FractalType::Heterogeneous: return selectKernel<FractalType::Heterogeneous, Derivatives>(numOctaves, octaveCounts);
+			default: return selectKernel<FractalType::HybridMultifractal, Derivatives>(numOctaves, octaveCounts);
+			}
+		}
+	}
+
+
+	Fbm::Fbm(const FractalParams& params, const PermutationTable& perm)
+		: m_params(params), m_octaves(params), m_perm(&perm) {
+		m_kernel = selectKernel<false>(params.type, m_octaves.numOctaves);
+		m_derivativeKernel = selectKernel<true>(params.type, m_octaves.numOctaves);
+	}
+
+	void Fbm::evaluate(const float* xs, const float* ys, float* out, int n) const {
+		m_kernel(*m_perm, m_params, m_octaves, xs, ys, out, nullptr, nullptr, n);
+	}
+
+	void Fbm::evaluate(const float* xs, const float* ys, float* out, float* outDx, float* outDy, int n) const {
+		m_derivativeKernel(*m_perm, m_params, m_octaves, xs, ys, out, outDx, outDy, n);
+	}
+
+	float Fbm::evaluate(float x, float y) const {
+		float out;
+		m_kernel(*m_perm, m_params, m_octaves, &x, &y, &out, nullptr, nullptr, 1);
+		return out;
+	}
+
+
+	void Fbm::evaluateOctave(int octave, const float* xs, const float* ys, float* noise, float* noiseDx, float* noiseDy, int n) const {
+		const double frequency = m_octaves.frequency[octave];
+		float octaveX[blockSize], octaveY[blockSize];
+		for (int start = 0; start < n; start += blockSize) {
+			int count = std::min(blockSize, n - start);
+			// same rounding steps as fbmBlock, so the noise matches what evaluate() sees
+			for (int k = 0; k < count; k++) {
+				float baseX = xs[start + k] * m_params.baseFrequency;
+				float baseY = ys[start + k] * m_params.baseFrequency;
+				octaveX[k] = float(baseX * frequency);
+				octaveY[k] = float(baseY * frequency);
+			}
+			noiseBatch(m_params.basis, *m_perm, octaveX, octaveY, noise + start, noiseDx + start, noiseDy + start, count);
+		}
+	}
+
+	void Fbm::combine(const float* const* noise, const float* const* noiseDx, const float* const* noiseDy,
+		float* out, float* outDx, float* outDy, int n) const {
+		bool derivatives = outDx && outDy;
+		switch (m_params.type) {
+		case FractalType::Homogeneous:
+			if (derivatives) combineOctaves<FractalType::Homogeneous, true>(m_params, m_octaves, noise, noiseDx, noiseDy, out, outDx, outDy, n);
+			else combineOctaves<FractalType::Homogeneous, false>(m_params, m_octaves, noise, noiseDx, noiseDy, out, outDx, outDy, n);
+			break;
+		case FractalType::Heterogeneous:
+			if (derivatives) combineOctaves<FractalType::Heterogeneous, true>(m_params, m_octaves, noise, noiseDx, noiseDy, out, outDx, outDy, n);
+			else combineOctaves<FractalType::Heterogeneous, false>(m_params, m_octaves, noise, noiseDx, noiseDy, out, outDx, outDy, n);
+			break;
+		default:
+			if (derivatives) combineOctaves<FractalType::HybridMultifractal, true>(m_params, m_octaves, noise, noiseDx, noiseDy, out, outDx, outDy, n);
+			else combineOctaves<FractalType::HybridMultifractal, false>(m_params, m_octaves, noise, noiseDx, noiseDy, out, outDx, outDy, n);
+			break;
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+// project
+#include "noise.hpp"
+
+namespace terrain {
+
+	enum class FractalType : int {
+		Homogeneous = 0,	// normal terrain
+		Heterogeneous = 1,	// smooth valleys
+		HybridMultifractal = 2
+	};
+
+	struct FractalParams {
+		FractalType type = FractalType::Heterogeneous;
+		NoiseBasis basis = NoiseBasis::Perlin;
+		float baseFrequency = 0.04f;
+		// 0 to OctaveTable::maxOctaves, a debug build asserts on counts outside it and a release
+		// build clamps them into it
+		int numOctaves = 6;
+		float frequencyMultiplier = 2;
+		float amtitudeMultiplier = 0.5f;
+
+		// hybrid multifractal only
+		float offset = 0.7f;
+		float H = 0.25f;
+	};
+
+
+	// Per-octave frequency and amplitude multipliers, computed once per generation so the
+	// per-sample octave loop has no pow() calls.
+	// Kept in double because that is the precision the original per-sample pow() produced,
+	// so tabulated results match the old code exactly.
+	struct OctaveTable {
+		static constexpr int maxOctaves = 16;
+
+		int numOctaves = 0;
+		double frequency[maxOctaves]; // frequencyMultiplier^i
+		double amptitude[maxOctaves]; // amtitudeMultiplier^i, or (amtitudeMultiplier^i)^H for the hybrid multifractal
+
+		OctaveTable() = default;
+		explicit OctaveTable(const FractalParams& params);
+	};
+
+
+	// Fractal Brownian motion built on the batched noise kernel of params.basis.
+	// The fractal type and octave count are picked once on construction from a set of
+	// template specialised kernels, so the inner loops contain no branches on either.
+	class Fbm {
+	public:
+		using Kernel = void(*)(const PermutationTable& perm, const FractalParams& params, const OctaveTable& octaves,
+			const float* xs, const float* ys, float* out, float* outDx, float* outDy, int n);
+
+		Fbm(const FractalParams& params, const PermutationTable& perm);
+
+		// raw fractal value for n samples at (xs[i], ys[i])
+		void evaluate(const float* xs, const float* ys, float* out, int n) const;
+		float evaluate(float x, float y) const;
+
+		// fractal value plus its analytic gradient with respect to the sample coordinates.
+		// Values are identical to the ones from evaluate() without derivatives.
+		void evaluate(const float* xs, const float* ys, float* out, float* outDx, float* outDy, int n) const;
+
+		// Raw noise of one octave and its gradient with respect to the octave coordinate, for caching.
+		// Only depends on the permutation table, baseFrequency, frequencyMultiplier and the octave.
+		void evaluateOctave(int octave, const float* xs, const float* ys, float* noise, float* noiseDx, float* noiseDy, int n) const;
+
+		// Combines cached octaves (noise[i] points at n samples of octave i from evaluateOctave) into
+		// the fractal value, with the gradient unless outDx/outDy are null. Identical to evaluate()
+		// at the same samples, for a few multiply-adds per octave instead of gradient noise.
+		void combine(const float* const* noise, const float* const* noiseDx, const float* const* noiseDy,
+			float* out, float* outDx, float* outDy, int n) const;
+
+		int numOctaves() const { return m_octaves.numOctaves; }
+		const FractalParams& params() const { return m_params; }
+
+	private:
+		FractalParams m_params;
+		OctaveTable m_octaves;
+		const PermutationTable* m_perm;
+		Kernel m_kernel;
+		Kernel m_derivativeKernel;
+	};
+}
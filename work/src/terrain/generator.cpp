@@ -0,0 +1,154 @@
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// project
+#include "generator.hpp"
+
+
+using namespace glm;
+
+namespace terrain {
+
+	namespace {
+		// Fills a height map (and normals) row by row. evaluateRow(y, xs, ys, out, dxs, dys, n) writes the
+		// raw fractal value of the n samples of row y to out, and its gradient to dxs/dys unless they are null.
+		template <typename EvaluateRow>
+		Heightfield fillHeightfield(const GenerationParams& params, std::vector<vec3>* normals, ThreadPool& pool,
+			const std::atomic<bool>* cancel, const EvaluateRow& evaluateRow) {
+
+			const int size = params.size;
+			const int rowLength = size + 2;
+			Heightfield heightMap(size, size, 1);
+			if (normals) normals->resize(size_t(size) * size);
+
+			const float heightOffset = params.fractal.type == FractalType::Homogeneous ? 0.0f : 0.5f;
+
+			//every row only depends on its own coordinates, so tiles of rows are filled in parallel
+			pool.parallelFor(-1, size + 1, ThreadPool::rowsPerTile, [&](int yBegin, int yEnd) {
+				if (cancel && *cancel) return;
+				std::vector<float> xs(rowLength), ys(rowLength), dxs(rowLength), dys(rowLength);
+				for (int y = yBegin; y < yEnd; y++) {
+					//sample positions start at the corner of the border
+					for (int x = -1; x < size + 1; x++) {
+						xs[x + 1] = float(params.origin.x + x * params.stride + 1) * params.squareSize;
+						ys[x + 1] = float(params.origin.y + y * params.stride + 1) * params.squareSize;
+					}
+
+					//evaluate the whole row (including the border) at once
+					float* row = heightMap.row(y) - 1;
+					evaluateRow(y, xs.data(), ys.data(), row, normals ? dxs.data() : nullptr, normals ? dys.data() : nullptr, rowLength);
+					for (int x = 0; x < rowLength; x++) {
+						row[x] = (row[x] - heightOffset) * params.scale;
+					}
+
+					//normals straight from the gradient. Same as the old central difference of neighbouring
+					//heights (divided by scale) over 2 squares, without needing the neighbours
+					if (!normals || y < 0 || y >= size) continue;
+					vec3* normalRow = normals->data() + size_t(y) * size;
+					for (int x = 0; x < size; x++) {
+						normalRow[x] = normalize(vec3(-dxs[x + 1] * params.squareSize, 1, -dys[x + 1] * params.squareSize));
+					}
+				}
+			});
+
+			return heightMap;
+		}
+	}
+
+
+	Heightfield generateHeightfield(const GenerationParams& params, const PermutationTable& perm,
+		std::vector<vec3>* normals, ThreadPool& pool, const std::atomic<bool>* cancel) {
+
+		//octave weights and the fractal kernel are worked out once here, not per sample
+		Fbm fbm(params.fractal, perm);
+
+		return fillHeightfield(params, normals, pool, cancel, [&](int, const float* xs, const float* ys, float* out, float* dxs, float* dys, int n) {
+			if (dxs) {
+				fbm.evaluate(xs, ys, out, dxs, dys, n);
+			}
+			else {
+				fbm.evaluate(xs, ys, out, n);
+			}
+		});
+	}
+
+
+	bool OctaveLayerCache::GridKey::operator==(const GridKey& other) const {
+		return std::memcmp(perm.p, other.perm.p, sizeof(perm.p)) == 0 && perm.hashSeed == other.perm.hashSeed
+			&& basis == other.basis && baseFrequency == other.baseFrequency && frequencyMultiplier == other.frequencyMultiplier
+			&& size == other.size && squareSize == other.squareSize && origin == other.origin && stride == other.stride;
+	}
+
+
+	Heightfield OctaveLayerCache::generate(const GenerationParams& params, const PermutationTable& perm,
+		std::vector<vec3>* normals, ThreadPool& pool, const std::atomic<bool>* cancel) {
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		//the stored octaves are only any use on exactly the same grid of the same noise
+		GridKey key{ perm, params.fractal.basis, params.fractal.baseFrequency, params.fractal.frequencyMultiplier, params.size, params.squareSize, params.origin, params.stride };
+		if (m_validOctaves == 0 || !(key == m_key)) {
+			m_key = key;
+			m_validOctaves = 0;
+		}
+
+		Fbm fbm(params.fractal, perm);
+		const int numOctaves = fbm.numOctaves();
+		const int firstMissing = m_validOctaves;
+		const size_t rowLength = size_t(params.size) + 2;
+		const size_t layerSize = rowLength * rowLength;
+		for (std::vector<std::vector<float>>* layers : { &m_noise, &m_noiseDx, &m_noiseDy }) {
+			if (int(layers->size()) < numOctaves) layers->resize(numOctaves);
+			for (int i = firstMissing; i < numOctaves; i++) (*layers)[i].resize(layerSize);
+		}
+
+		Heightfield heightMap = fillHeightfield(params, normals, pool, cancel, [&](int y, const float* xs, const float* ys, float* out, float* dxs, float* dys, int n) {
+			//sample the octaves we don't have yet, then recombine all of them
+			const float* noise[OctaveTable::maxOctaves];
+			const float* noiseDx[OctaveTable::maxOctaves];
+			const float* noiseDy[OctaveTable::maxOctaves];
+			const size_t rowStart = size_t(y + 1) * rowLength;
+			for (int i = 0; i < numOctaves; i++) {
+				if (i >= firstMissing) {
+					fbm.evaluateOctave(i, xs, ys, &m_noise[i][rowStart], &m_noiseDx[i][rowStart], &m_noiseDy[i][rowStart], n);
+				}
+				noise[i] = &m_noise[i][rowStart];
+				noiseDx[i] = &m_noiseDx[i][rowStart];
+				noiseDy[i] = &m_noiseDy[i][rowStart];
+			}
+			fbm.combine(noise, noiseDx, noiseDy, out, dxs, dys, n);
+		});
+
+		//rows skipped by a cancel left the new octaves incomplete
+		if (!(cancel && *cancel)) {
+			m_validOctaves = std::max(m_validOctaves, numOctaves);
+		}
+		return heightMap;
+	}
+
+
+	void OctaveLayerCache::clear() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_validOctaves = 0;
+		m_noise.clear();
+		m_noiseDx.clear();
+		m_noiseDy.clear();
+	}
+
+	int OctaveLayerCache::octaveCount() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_validOctaves;
+	}
+
+	size_t OctaveLayerCache::bytes() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t total = 0;
+		for (const std::vector<std::vector<float>>* layers : { &m_noise, &m_noiseDx, &m_noiseDy }) {
+			for (const std::vector<float>& layer : *layers) total += layer.capacity() * sizeof(float);
+		}
+		return total;
+	}
+}
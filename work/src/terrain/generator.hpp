@@ -0,0 +1,80 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "heightfield.hpp"
+#include "fbm.hpp"
+#include "thread_pool.hpp"
+
+namespace terrain {
+
+	// Everything that decides the shape of a generated (un-eroded) terrain except the seed.
+	struct GenerationParams {
+		FractalParams fractal;
+		float scale = 25;			// heights are multiplied by this
+		int size = 201;				// number of samples along each side
+		float squareSize = 0.5f;	// distance between neighbouring samples
+		glm::ivec2 origin{ 0 };		// global index of sample (0, 0), so neighbouring tiles line up
+		int stride = 1;				// only every stride-th sample of the grid, for low resolution previews
+	};
+
+	// Generates a size x size height map with a 1 sample border around it (erosion uses the border
+	// as its fixed boundary). Sample (x, y) is taken at ((origin.x + x * stride + 1) * squareSize,
+	// (origin.y + y * stride + 1) * squareSize); positions come from the global integer index, so a
+	// sample shared by two tiles (or by a preview and the full resolution map) gets exactly the
+	// same value in both. Normals are the same as the full resolution ones at those samples.
+	// If normals is given it is resized to size * size and filled from the analytic fbm gradient,
+	// matching a central difference of the heights divided by scale.
+	// Rows are filled in tiles on the pool; the result doesn't depend on the number of threads.
+	// Once cancel is set the remaining rows are skipped and the result is incomplete.
+	Heightfield generateHeightfield(const GenerationParams& params, const PermutationTable& perm,
+		std::vector<glm::vec3>* normals = nullptr, ThreadPool& pool = ThreadPool::shared(),
+		const std::atomic<bool>* cancel = nullptr);
+
+
+	// Keeps the raw noise of every octave sampled over the last generated grid, so changing only
+	// how the octaves are combined (amplitude multiplier, H, offset, fractal type, scale) or adding
+	// octaves reuses the stored layers instead of sampling the noise again. The layers are kept as
+	// long as the seed, frequencies and the sample grid stay the same.
+	// Results are identical to generateHeightfield().
+	class OctaveLayerCache {
+	public:
+		// same as generateHeightfield(), sampling only the octaves that aren't cached yet
+		Heightfield generate(const GenerationParams& params, const PermutationTable& perm,
+			std::vector<glm::vec3>* normals = nullptr, ThreadPool& pool = ThreadPool::shared(),
+			const std::atomic<bool>* cancel = nullptr);
+
+		void clear();
+		int octaveCount() const;
+		std::size_t bytes() const;
+
+	private:
+		// everything the raw octave noise depends on
+		struct GridKey {
+			PermutationTable perm;
+			NoiseBasis basis = NoiseBasis::Perlin;
+			float baseFrequency = 0;
+			float frequencyMultiplier = 0;
+			int size = 0;
+			float squareSize = 0;
+			glm::ivec2 origin{ 0 };
+			int stride = 0;
+
+			bool operator==(const GridKey& other) const;
+		};
+
+		GridKey m_key;
+		int m_validOctaves = 0;
+		// [octave][(y + 1) * (size + 2) + x + 1], the border included
+		std::vector<std::vector<float>> m_noise, m_noiseDx, m_noiseDy;
+		mutable std::mutex m_mutex;
+	};
+}
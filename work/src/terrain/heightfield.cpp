@@ -0,0 +1,85 @@
+
+// std
+#include <algorithm>
+#include <new>
+
+// project
+#include "heightfield.hpp"
+
+
+namespace terrain {
+
+	namespace {
+		float* allocateAligned(std::size_t count) {
+			if (count == 0) return nullptr;
+			return static_cast<float*>(::operator new(count * sizeof(float), std::align_val_t(Heightfield::alignment)));
+		}
+	}
+
+	void Heightfield::AlignedDelete::operator()(float* p) const {
+		::operator delete(p, std::align_val_t(Heightfield::alignment));
+	}
+
+
+	Heightfield::Heightfield(int width, int height, int border, float value)
+		: m_width(width), m_height(height), m_border(border) {
+		assert(width >= 0 && height >= 0 && border >= 0);
+
+		// round each padded row up to a whole number of alignment blocks
+		const std::ptrdiff_t floatsPerBlock = alignment / sizeof(float);
+		std::ptrdiff_t paddedWidth = width + 2 * border;
+		m_stride = (paddedWidth + floatsPerBlock - 1) / floatsPerBlock * floatsPerBlock;
+
+		m_data.reset(allocateAligned(allocatedSize()));
+		m_origin = m_data.get() + border * m_stride + border;
+		fill(value);
+	}
+
+	Heightfield::Heightfield(const Heightfield& other)
+		: m_width(other.m_width), m_height(other.m_height), m_border(other.m_border), m_stride(other.m_stride) {
+		m_data.reset(allocateAligned(allocatedSize()));
+		m_origin = m_data.get() + (other.m_origin - other.m_data.get());
+		std::copy(other.m_data.get(), other.m_data.get() + allocatedSize(), m_data.get());
+	}
+
+	Heightfield::Heightfield(Heightfield&& other) noexcept
+		: m_data(std::move(other.m_data)), m_origin(other.m_origin), m_width(other.m_width),
+		m_height(other.m_height), m_border(other.m_border), m_stride(other.m_stride) {
+		other.m_origin = nullptr;
+		other.m_width = other.m_height = other.m_border = 0;
+		other.m_stride = 0;
+	}
+
+	Heightfield& Heightfield::operator=(const Heightfield& other) {
+		if (this == &other) return *this;
+
+		if (sameShape(other) && m_data) {
+			// reuse the existing allocation
+			std::copy(other.m_data.get(), other.m_data.get() + allocatedSize(), m_data.get());
+		}
+		else {
+			*this = Heightfield(other);
+		}
+		return *this;
+	}
+
+	Heightfield& Heightfield::operator=(Heightfield&& other) noexcept {
+		if (this == &other) return *this;
+
+		m_data = std::move(other.m_data);
+		m_origin = other.m_origin;
+		m_width = other.m_width;
+		m_height = other.m_height;
+		m_border = other.m_border;
+		m_stride = other.m_stride;
+
+		other.m_origin = nullptr;
+		other.m_width = other.m_height = other.m_border = 0;
+		other.m_stride = 0;
+		return *this;
+	}
+
+	void Heightfield::fill(float value) {
+		std::fill(m_data.get(), m_data.get() + allocatedSize(), value);
+	}
+}
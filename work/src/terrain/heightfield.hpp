@@ -0,0 +1,116 @@
+#pragma once
+
+// std
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+namespace terrain {
+
+	// Non-owning view of a row-major 2D float field.
+	// (0, 0) is the first interior sample. Negative coordinates (and coordinates past
+	// width/height) are valid as long as the underlying storage has a border that covers them.
+	template <typename T>
+	struct BasicHeightfieldView {
+		T* origin = nullptr;
+		int width = 0;
+		int height = 0;
+		std::ptrdiff_t stride = 0; // distance (in floats) between the starts of two rows
+
+		T& operator()(int x, int y) const { return origin[y * stride + x]; }
+
+		// pointer to sample (0, y), index it with x
+		T* row(int y) const { return origin + y * stride; }
+
+		// view of the w*h rectangle starting at (x, y), sharing the same storage
+		BasicHeightfieldView subview(int x, int y, int w, int h) const {
+			return BasicHeightfieldView{ origin + y * stride + x, w, h, stride };
+		}
+
+		// allow a mutable view to be passed where a const view is expected
+		operator BasicHeightfieldView<const T>() const {
+			return BasicHeightfieldView<const T>{ origin, width, height, stride };
+		}
+	};
+
+	using HeightfieldView = BasicHeightfieldView<float>;
+	using ConstHeightfieldView = BasicHeightfieldView<const float>;
+
+
+	// 2D grid of floats (heights, water volume, sediment ...) stored in one contiguous,
+	// 64 byte aligned allocation instead of a vector of separately allocated rows.
+	// The field has an optional border of padding samples around it, so stencils can read
+	// (x-1, y) ... (x+1, y) at the edges without bounds checks.
+	// Every padded row starts on an alignment boundary, so stride() >= width() + 2 * border().
+	class Heightfield {
+	public:
+		static constexpr std::size_t alignment = 64;
+
+		Heightfield() = default;
+		Heightfield(int width, int height, int border = 0, float value = 0);
+
+		Heightfield(const Heightfield& other);
+		Heightfield(Heightfield&& other) noexcept;
+		Heightfield& operator=(const Heightfield& other);
+		Heightfield& operator=(Heightfield&& other) noexcept;
+
+		int width() const { return m_width; }
+		int height() const { return m_height; }
+		int border() const { return m_border; }
+		std::ptrdiff_t stride() const { return m_stride; }
+		bool empty() const { return m_width == 0 || m_height == 0; }
+
+		// sample access, (x, y) in [-border, width + border) x [-border, height + border)
+		float& operator()(int x, int y) {
+			assert(inBounds(x, y));
+			return m_origin[y * m_stride + x];
+		}
+		float operator()(int x, int y) const {
+			assert(inBounds(x, y));
+			return m_origin[y * m_stride + x];
+		}
+
+		// pointer to sample (0, y)
+		float* row(int y) { return m_origin + y * m_stride; }
+		const float* row(int y) const { return m_origin + y * m_stride; }
+
+		// views of the interior (border still reachable through negative coordinates)
+		HeightfieldView view() { return HeightfieldView{ m_origin, m_width, m_height, m_stride }; }
+		ConstHeightfieldView view() const { return ConstHeightfieldView{ m_origin, m_width, m_height, m_stride }; }
+
+		// views that include the border as part of the field
+		HeightfieldView paddedView() {
+			return HeightfieldView{ m_data.get(), m_width + 2 * m_border, m_height + 2 * m_border, m_stride };
+		}
+		ConstHeightfieldView paddedView() const {
+			return ConstHeightfieldView{ m_data.get(), m_width + 2 * m_border, m_height + 2 * m_border, m_stride };
+		}
+
+		// sets every sample (including the border and row padding)
+		void fill(float value);
+
+		// true if this field has the same dimensions as other
+		bool sameShape(const Heightfield& other) const {
+			return m_width == other.m_width && m_height == other.m_height && m_border == other.m_border;
+		}
+
+	private:
+		struct AlignedDelete {
+			void operator()(float* p) const;
+		};
+
+		std::unique_ptr<float[], AlignedDelete> m_data; // start of the padded storage
+		float* m_origin = nullptr; // sample (0, 0)
+		int m_width = 0;
+		int m_height = 0;
+		int m_border = 0;
+		std::ptrdiff_t m_stride = 0;
+
+		std::size_t allocatedSize() const { return std::size_t(m_stride) * (m_height + 2 * m_border); }
+
+		bool inBounds(int x, int y) const {
+			return x >= -m_border && x < m_width + m_border && y >= -m_border && y < m_height + m_border;
+		}
+	};
+
+}
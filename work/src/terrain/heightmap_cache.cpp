@@ -0,0 +1,215 @@
+
+// std
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+// platform
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// project
+#include "heightmap_cache.hpp"
+#include "mapped_file.hpp"
+
+
+namespace terrain {
+
+	namespace {
+		// bump when the file layout, the generator or the erosion change what a key produces
+		const std::uint32_t formatVersion = 3;
+		const char fileMagic[8] = { 'C', 'G', 'R', 'A', 'H', 'M', 'A', 'P' };
+
+		// bits of FileHeader::layers
+		const std::uint32_t HasWaterVolume = 1;
+		const std::uint32_t HasNormals = 2;
+
+		struct FileHeader {
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t layers;
+			std::uint64_t key;
+			std::int32_t width;
+			std::int32_t height;
+			std::int32_t border;
+			std::uint32_t reserved;
+		};
+
+		// FNV-1a over each field's bytes (never over whole structs, padding isn't defined)
+		class Hasher {
+		public:
+			template <typename T>
+			Hasher& add(const T& value) {
+				const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+				for (std::size_t i = 0; i < sizeof(T); i++) {
+					m_hash = (m_hash ^ bytes[i]) * 0x100000001B3ull;
+				}
+				return *this;
+			}
+
+			std::uint64_t hash() const { return m_hash; }
+
+		private:
+			std::uint64_t m_hash = 0xCBF29CE484222325ull;
+		};
+
+		// samples in a layer that is stored with its border
+		std::size_t paddedSamples(int width, int height, int border) {
+			return std::size_t(width + 2 * border) * std::size_t(height + 2 * border);
+		}
+
+		unsigned long processId() {
+#ifdef _WIN32
+			return GetCurrentProcessId();
+#else
+			return static_cast<unsigned long>(getpid());
+#endif
+		}
+	}
+
+
+	CacheKey generationKey(std::uint64_t seed, const GenerationParams& params) {
+		Hasher h;
+		h.add(formatVersion).add(seed);
+		//the octave count the fbm actually uses, so out of range counts share the key of what they make
+		int numOctaves = std::max(0, std::min(params.fractal.numOctaves, OctaveTable::maxOctaves));
+		h.add(int(params.fractal.type)).add(int(params.fractal.basis)).add(params.fractal.baseFrequency).add(numOctaves);
+		h.add(params.fractal.frequencyMultiplier).add(params.fractal.amtitudeMultiplier);
+		h.add(params.fractal.offset).add(params.fractal.H);
+		h.add(params.scale).add(params.size).add(params.squareSize);
+		h.add(params.origin.x).add(params.origin.y).add(params.stride);
+		return h.hash();
+	}
+
+	CacheKey erosionKey(CacheKey terrain, const ErosionParams& params, int iterations) {
+		Hasher h;
+		h.add(terrain).add(int(params.type)).add(iterations);
+		h.add(params.talusThreshold).add(params.sedimentvolume).add(int(params.thermalUpdate)).add(int(params.traversal));
+		h.add(int(params.hydraulic)).add(params.kr).add(params.ks).add(params.ke).add(params.kc);
+		h.add(params.dropletsPerCell).add(params.dropletLifetime);
+		return h.hash();
+	}
+
+
+	HeightmapCache::HeightmapCache(std::string directory) : m_directory(std::move(directory)) { }
+
+	std::string HeightmapCache::filename(CacheKey key) const {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.hmap", (unsigned long long)key);
+		return (std::filesystem::path(m_directory) / name).string();
+	}
+
+	std::string HeightmapCache::defaultDirectory() {
+		std::error_code ec;
+		std::filesystem::path temp = std::filesystem::temp_directory_path(ec);
+		if (ec) return "";
+		return (temp / "cgra_terrain_cache").string();
+	}
+
+
+	bool HeightmapCache::load(CacheKey key, Heightfield& heightMap, Heightfield* waterVolume, std::vector<glm::vec3>* normals) const {
+		if (!enabled()) return false;
+
+		MappedFile file;
+		if (!file.open(filename(key)) || file.size() < sizeof(FileHeader)) return false;
+
+		FileHeader header;
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != formatVersion || header.key != key) return false;
+		if (header.width <= 0 || header.height <= 0 || header.border < 0) return false;
+		if (waterVolume && !(header.layers & HasWaterVolume)) return false;
+		if (normals && !(header.layers & HasNormals)) return false;
+
+		// check the size before touching any samples, a truncated file is a miss
+		std::size_t layerSamples = paddedSamples(header.width, header.height, header.border);
+		std::size_t expected = sizeof(FileHeader) + layerSamples * sizeof(float);
+		if (header.layers & HasWaterVolume) expected += layerSamples * sizeof(float);
+		if (header.layers & HasNormals) expected += std::size_t(header.width) * header.height * sizeof(glm::vec3);
+		if (file.size() != expected) return false;
+
+		const unsigned char* data = file.data() + sizeof(FileHeader);
+		auto readLayer = [&](Heightfield& field) {
+			field = Heightfield(header.width, header.height, header.border);
+			HeightfieldView padded = field.paddedView();
+			std::size_t rowBytes = std::size_t(padded.width) * sizeof(float);
+			for (int y = 0; y < padded.height; y++) {
+				std::memcpy(padded.row(y), data, rowBytes);
+				data += rowBytes;
+			}
+		};
+
+		readLayer(heightMap);
+		if (header.layers & HasWaterVolume) {
+			if (waterVolume) readLayer(*waterVolume);
+			else data += layerSamples * sizeof(float);
+		}
+		if (normals) {
+			normals->resize(std::size_t(header.width) * header.height);
+			std::memcpy(normals->data(), data, normals->size() * sizeof(glm::vec3));
+		}
+		return true;
+	}
+
+
+	bool HeightmapCache::store(CacheKey key, const Heightfield& heightMap, const Heightfield* waterVolume, const std::vector<glm::vec3>* normals) const {
+		if (!enabled()) return false;
+		if (waterVolume && !waterVolume->sameShape(heightMap)) return false;
+		if (normals && normals->size() != std::size_t(heightMap.width()) * heightMap.height()) return false;
+
+		std::error_code ec;
+		std::filesystem::create_directories(m_directory, ec);
+		if (ec) return false;
+
+		FileHeader header = {};
+		std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+		header.version = formatVersion;
+		header.layers = (waterVolume ? HasWaterVolume : 0u) | (normals ? HasNormals : 0u);
+		header.key = key;
+		header.width = heightMap.width();
+		header.height = heightMap.height();
+		header.border = heightMap.border();
+
+		// unique per process and thread, so concurrent stores of the same key (from this or another
+		// process sharing the directory) don't write the same temporary file
+		std::string target = filename(key);
+		std::string temporary = target + "." + std::to_string(processId()) + "."
+			+ std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+		{
+			std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+			if (!out) return false;
+
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			auto writeLayer = [&](const Heightfield& field) {
+				ConstHeightfieldView padded = field.paddedView();
+				for (int y = 0; y < padded.height; y++) {
+					out.write(reinterpret_cast<const char*>(padded.row(y)), std::streamsize(padded.width) * sizeof(float));
+				}
+			};
+			writeLayer(heightMap);
+			if (waterVolume) writeLayer(*waterVolume);
+			if (normals) out.write(reinterpret_cast<const char*>(normals->data()), std::streamsize(normals->size() * sizeof(glm::vec3)));
+
+			if (!out.flush()) {
+				out.close();
+				std::filesystem::remove(temporary, ec);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(temporary, target, ec);
+		if (ec) {
+			std::filesystem::remove(temporary, ec);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "heightfield.hpp"
+#include "generator.hpp"
+#include "erosion.hpp"
+
+namespace terrain {
+
+	// 64 bit hash of everything that decides a terrain stage
+	using CacheKey = std::uint64_t;
+
+	// key of a generated (un-eroded) terrain
+	CacheKey generationKey(std::uint64_t seed, const GenerationParams& params);
+
+	// key of the terrain with the given key after a whole erosion (see erodeTerrain)
+	CacheKey erosionKey(CacheKey terrain, const ErosionParams& params, int iterations);
+
+
+	// Content addressed cache of terrain stages on disk, one small binary file per key.
+	// A hit memory maps the file and copies it into the height map, a miss is stored by writing a
+	// temporary file and renaming it over the final name, so readers never see a partial file and
+	// several processes can share a cache directory.
+	// Files are in host byte order; files from another version or machine are simply misses.
+	class HeightmapCache {
+	public:
+		// an empty directory disables the cache (every load misses, stores do nothing)
+		explicit HeightmapCache(std::string directory = "");
+
+		const std::string& directory() const { return m_directory; }
+		bool enabled() const { return !m_directory.empty(); }
+
+		// Loads the stage stored for key. waterVolume and normals are optional layers, and the load
+		// fails if one is asked for but wasn't stored. Nothing is changed on a miss.
+		bool load(CacheKey key, Heightfield& heightMap, Heightfield* waterVolume = nullptr, std::vector<glm::vec3>* normals = nullptr) const;
+
+		// stores a stage (water volume must have the height map's shape), returns false if it couldn't be written
+		bool store(CacheKey key, const Heightfield& heightMap, const Heightfield* waterVolume = nullptr, const std::vector<glm::vec3>* normals = nullptr) const;
+
+		std::string filename(CacheKey key) const;
+
+		// cache in the system's temporary directory, shared by every run of the program
+		static std::string defaultDirectory();
+
+	private:
+		std::string m_directory;
+	};
+}
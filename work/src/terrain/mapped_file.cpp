@@ -0,0 +1,114 @@
+
+// std
+#include <utility>
+
+// platform
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// project
+#include "mapped_file.hpp"
+
+
+namespace terrain {
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+		if (this != &other) {
+			close();
+			std::swap(m_data, other.m_data);
+			std::swap(m_size, other.m_size);
+#ifdef _WIN32
+			std::swap(m_mapping, other.m_mapping);
+#endif
+		}
+		return *this;
+	}
+
+
+#ifdef _WIN32
+
+	bool MappedFile::open(const std::string& filename) {
+		close();
+
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+
+		// the mapping keeps the file open, so the file handle isn't needed after this
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping) return false;
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view) {
+			CloseHandle(mapping);
+			return false;
+		}
+
+		m_mapping = mapping;
+		m_data = static_cast<const unsigned char*>(view);
+		m_size = std::size_t(size.QuadPart);
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_size = 0;
+	}
+
+#else
+
+	bool MappedFile::open(const std::string& filename) {
+		close();
+
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+
+		// the mapping keeps the file open, so the descriptor isn't needed after this
+		void* view = mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED) return false;
+
+		m_data = static_cast<const unsigned char*>(view);
+		m_size = std::size_t(info.st_size);
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (m_data) munmap(const_cast<unsigned char*>(m_data), m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+#endif
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <string>
+
+namespace terrain {
+
+	// Read-only memory mapping of a whole file (mmap on POSIX, a file mapping on Windows).
+	// The mapping is released when the object is destroyed.
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		// maps the file, returns false if it doesn't exist, is empty or can't be mapped
+		bool open(const std::string& filename);
+		void close();
+
+		bool isOpen() const { return m_data != nullptr; }
+		const unsigned char* data() const { return m_data; }
+		std::size_t size() const { return m_size; }
+
+	private:
+		const unsigned char* m_data = nullptr;
+		std::size_t m_size = 0;
+#ifdef _WIN32
+		void* m_mapping = nullptr;
+#endif
+	};
+}
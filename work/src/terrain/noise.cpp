@@ -0,0 +1,763 @@
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// simd
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TERRAIN_NOISE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_NOISE_SSE2
+#endif
+
+// project
+#include "noise.hpp"
+
+
+namespace terrain {
+
+	const int referencePermutations[256] = {
+		151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,
+		103,30,69,142,8,99,37,240,21,10,23,190, 6,148,247,120,234,75,0,
+		26,197,62,94,252,219,203,117,35,11,32,57,177,33,88,237,149,56,
+		87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
+		77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,
+		46,245,40,244,102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,
+		187,208, 89,18,169,200,196,135,130,116,188,159,86,164,100,109,
+		198,173,186, 3,64,52,217,226,250,124,123,5,202,38,147,118,126,
+		255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,223,183,
+		170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,
+		172,9,129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,
+		104,218,246,97,228,251,34,242,193,238,210,144,12,191,179,162,241,
+		81,51,145,235,249,14,239,107,49,192,214, 31,181,199,106,157,184,
+		84,204,176,115,121,50,45,127, 4,150,254,138,236,205,93,222,114,
+		67,29,24,72,243,141,128,195,78,66,215,61,156,180
+	};
+
+
+	PermutationTable::PermutationTable(const int(&permutations)[256]) {
+		for (int i = 0; i < 512; i++) {
+			p[i] = permutations[i & 255];
+		}
+	}
+
+
+	namespace {
+		float fade(float t) {
+			return t * t * t * (t * (t * 6 - 15) + 10);
+		}
+
+		//derivative of fade, 30t^2(t - 1)^2
+		float fadeDeriv(float t) {
+			return 30 * t * t * (t * (t - 2) + 1);
+		}
+
+		float lerp(float x, float p1, float p2) {
+			return p1 + x * (p2 - p1);
+		}
+
+		//the 4 constant vectors are (1,1), (-1,1), (-1,-1), (1,-1) for hash % 4 == 0, 1, 2, 3,
+		//so x is negated for hashes 1 and 2 and y is negated for hashes 2 and 3.
+		float gradX(int hash) {
+			return float(1 - ((hash + 1) & 2));
+		}
+
+		float gradY(int hash) {
+			return float(1 - (hash & 2));
+		}
+
+		//dot product of the corner's constant vector with (x, y) without branching.
+		float grad(int hash, float x, float y) {
+			return gradX(hash) * x + gradY(hash) * y;
+		}
+
+		//gradient noise at (xf, yf) inside a lattice square from the hashes of its four corners
+		template <bool Derivatives>
+		float gradientNoise(int TR, int TL, int BR, int BL, float xf, float yf, float* dx, float* dy) {
+			//get dot product of the constant vector and the vector to the point for each corner
+			float TR_Val = grad(TR, xf - 1.0f, yf - 1.0f);
+			float TL_Val = grad(TL, xf, yf - 1.0f);
+			float BR_Val = grad(BR, xf - 1.0f, yf);
+			float BL_Val = grad(BL, xf, yf);
+
+			//interp to get result
+			float u = fade(xf);
+			float v = fade(yf);
+			float interpTop = lerp(u, TL_Val, TR_Val);
+			float interpBottom = lerp(u, BL_Val, BR_Val);
+
+			if (Derivatives) {
+				//each corner value is linear in the point, so its derivative is the constant vector.
+				//differentiate the two lerps (product rule on the fade weights).
+				float du = fadeDeriv(xf);
+				float dv = fadeDeriv(yf);
+				float topDx = lerp(u, gradX(TL), gradX(TR)) + du * (TR_Val - TL_Val);
+				float bottomDx = lerp(u, gradX(BL), gradX(BR)) + du * (BR_Val - BL_Val);
+				float topDy = lerp(u, gradY(TL), gradY(TR));
+				float bottomDy = lerp(u, gradY(BL), gradY(BR));
+				*dx = lerp(v, bottomDx, topDx);
+				*dy = lerp(v, bottomDy, topDy) + dv * (interpTop - interpBottom);
+			}
+
+			return lerp(v, interpBottom, interpTop);
+		}
+
+		template <bool Derivatives>
+		float perlinNoiseImpl(const int* p, float x, float y, float* dx, float* dy) {
+			//get square corner and point in square coords
+			float fx = std::floor(x);
+			float fy = std::floor(y);
+			int X = int(fx) & 255;
+			int Y = int(fy) & 255;
+			float xf = x - fx;
+			float yf = y - fy;
+
+			//get hash for each corner
+			int TR = p[p[X + 1] + Y + 1];
+			int TL = p[p[X] + Y + 1];
+			int BR = p[p[X + 1] + Y];
+			int BL = p[p[X] + Y];
+
+			return gradientNoise<Derivatives>(TR, TL, BR, BL, xf, yf, dx, dy);
+		}
+
+
+		//odd multipliers that spread the lattice coordinates over all 32 bits before they are combined
+		constexpr std::uint32_t hashPrimeX = 0x8da6b343u;
+		constexpr std::uint32_t hashPrimeY = 0xd8163841u;
+
+		//Hashes the combined coordinates to a 3 bit gradient index, of which the square lattice noise
+		//uses the low 2 bits and simplex noise all 3. The top bits of a product depend on every bit
+		//below them, so one multiply (after folding the high half down) is enough
+		std::uint32_t mixHash(std::uint32_t h) {
+			h ^= h >> 16;
+			h *= 0x2c1b3c6du;
+			return h >> 29;
+		}
+
+		template <bool Derivatives>
+		float hashNoiseImpl(std::uint32_t seed, float x, float y, float* dx, float* dy) {
+			float fx = std::floor(x);
+			float fy = std::floor(y);
+			float xf = x - fx;
+			float yf = y - fy;
+
+			//the corner one step along is just one more multiplier away, so each axis is multiplied once
+			std::uint32_t X = std::uint32_t(int(fx)) * hashPrimeX;
+			std::uint32_t Y = std::uint32_t(int(fy)) * hashPrimeY;
+			std::uint32_t X1 = X + hashPrimeX;
+			std::uint32_t Y1 = Y + hashPrimeY;
+
+			int TR = int(mixHash(seed ^ X1 ^ Y1));
+			int TL = int(mixHash(seed ^ X ^ Y1));
+			int BR = int(mixHash(seed ^ X1 ^ Y));
+			int BL = int(mixHash(seed ^ X ^ Y));
+
+			return gradientNoise<Derivatives>(TR, TL, BR, BL, xf, yf, dx, dy);
+		}
+
+
+		//skew from the triangle grid onto the square grid and back, (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6
+		constexpr float simplexSkew = 0.36602540378f;
+		constexpr float simplexUnskew = 0.21132486541f;
+
+		//scales the sum of the corners to about [-1, 1]
+		constexpr float simplexScale = 99.0f;
+
+		//the 8 simplex corner gradients, unit vectors 45 degrees apart picked by the whole 3 bit hash.
+		//the 4 diagonals alone (as the square lattice noise uses) leave ridges along them
+		constexpr float simplexGradX[8] = { 1.0f, 0.70710678f, 0.0f, -0.70710678f, -1.0f, -0.70710678f, 0.0f, 0.70710678f };
+		constexpr float simplexGradY[8] = { 0.0f, 0.70710678f, 1.0f, 0.70710678f, 0.0f, -0.70710678f, -1.0f, -0.70710678f };
+
+		//contribution of the corner at offset (x, y) from the sample, with a (0.5 - r^2)^4 falloff
+		template <bool Derivatives>
+		float simplexCorner(int hash, float x, float y, float& dx, float& dy) {
+			float t = std::max(0.5f - x * x - y * y, 0.0f);
+			float t2 = t * t;
+			float t4 = t2 * t2;
+			float gx = simplexGradX[hash];
+			float gy = simplexGradY[hash];
+			float g = gx * x + gy * y;
+			if (Derivatives) {
+				//product rule, d(t^4)/dx = 4t^3 * -2x
+				float t3g = t2 * t * g * 8.0f;
+				dx += t4 * gx - t3g * x;
+				dy += t4 * gy - t3g * y;
+			}
+			return t4 * g;
+		}
+
+		template <bool Derivatives>
+		float simplexNoiseImpl(std::uint32_t seed, float x, float y, float* dx, float* dy) {
+			//skew the sample onto the square grid to find the square (and so the triangle pair) it's in
+			float s = (x + y) * simplexSkew;
+			float fi = std::floor(x + s);
+			float fj = std::floor(y + s);
+			float t = (fi + fj) * simplexUnskew;
+
+			//offsets of the sample from the three corners of its triangle, back in the unskewed space.
+			//the middle corner is along x in the lower triangle and along y in the upper one
+			float x0 = x - (fi - t);
+			float y0 = y - (fj - t);
+			bool lower = x0 > y0;
+			float i1 = lower ? 1.0f : 0.0f;
+			float j1 = 1.0f - i1;
+			float x1 = x0 - i1 + simplexUnskew;
+			float y1 = y0 - j1 + simplexUnskew;
+			float x2 = x0 - 1.0f + 2.0f * simplexUnskew;
+			float y2 = y0 - 1.0f + 2.0f * simplexUnskew;
+
+			//corner hashes, as in hashNoise
+			std::uint32_t I = std::uint32_t(int(fi)) * hashPrimeX;
+			std::uint32_t J = std::uint32_t(int(fj)) * hashPrimeY;
+			int h0 = int(mixHash(seed ^ I ^ J));
+			int h1 = int(mixHash(seed ^ (I + (lower ? hashPrimeX : 0)) ^ (J + (lower ? 0 : hashPrimeY))));
+			int h2 = int(mixHash(seed ^ (I + hashPrimeX) ^ (J + hashPrimeY)));
+
+			float ddx = 0, ddy = 0;
+			float n = simplexCorner<Derivatives>(h0, x0, y0, ddx, ddy);
+			n += simplexCorner<Derivatives>(h1, x1, y1, ddx, ddy);
+			n += simplexCorner<Derivatives>(h2, x2, y2, ddx, ddy);
+			if (Derivatives) {
+				*dx = ddx * simplexScale;
+				*dy = ddy * simplexScale;
+			}
+			return n * simplexScale;
+		}
+	}
+
+
+	float perlinNoise(const PermutationTable& perm, float x, float y) {
+		return perlinNoiseImpl<false>(perm.p, x, y, nullptr, nullptr);
+	}
+
+	float perlinNoise(const PermutationTable& perm, float x, float y, float& dx, float& dy) {
+		return perlinNoiseImpl<true>(perm.p, x, y, &dx, &dy);
+	}
+
+	float hashNoise(std::uint32_t seed, float x, float y) {
+		return hashNoiseImpl<false>(seed, x, y, nullptr, nullptr);
+	}
+
+	float hashNoise(std::uint32_t seed, float x, float y, float& dx, float& dy) {
+		return hashNoiseImpl<true>(seed, x, y, &dx, &dy);
+	}
+
+	float simplexNoise(std::uint32_t seed, float x, float y) {
+		return simplexNoiseImpl<false>(seed, x, y, nullptr, nullptr);
+	}
+
+	float simplexNoise(std::uint32_t seed, float x, float y, float& dx, float& dy) {
+		return simplexNoiseImpl<true>(seed, x, y, &dx, &dy);
+	}
+
+
+
+#if defined(TERRAIN_NOISE_AVX2)
+
+	namespace {
+		constexpr int batchWidth = 8;
+
+		__m256 fade8(__m256 t) {
+			__m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6)), _mm256_set1_ps(15))), _mm256_set1_ps(10));
+			return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+		}
+
+		__m256 fadeDeriv8(__m256 t) {
+			__m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(t, _mm256_set1_ps(2))), _mm256_set1_ps(1));
+			return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(30), t), t), inner);
+		}
+
+		__m256 lerp8(__m256 x, __m256 p1, __m256 p2) {
+			return _mm256_add_ps(p1, _mm256_mul_ps(x, _mm256_sub_ps(p2, p1)));
+		}
+
+		//sign bits of the corner's constant vector, as in gradX()/gradY()
+		void gradSigns8(__m256i hash, __m256& signX, __m256& signY) {
+			__m256i two = _mm256_set1_epi32(2);
+			signX = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(hash, _mm256_set1_epi32(1)), two), 30));
+			signY = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(hash, two), 30));
+		}
+
+		//flipping the sign bits is the same as multiplying by the +-1 components
+		__m256 grad8(__m256 signX, __m256 signY, __m256 x, __m256 y) {
+			return _mm256_add_ps(_mm256_xor_ps(x, signX), _mm256_xor_ps(y, signY));
+		}
+
+		//gradient noise from the hashes of the four corners, as gradientNoise()
+		template <bool Derivatives>
+		void gradientNoise8(__m256i TR, __m256i TL, __m256i BR, __m256i BL, __m256 xf, __m256 yf, float* out, float* dxs, float* dys) {
+			__m256 TR_SX, TR_SY, TL_SX, TL_SY, BR_SX, BR_SY, BL_SX, BL_SY;
+			gradSigns8(TR, TR_SX, TR_SY);
+			gradSigns8(TL, TL_SX, TL_SY);
+			gradSigns8(BR, BR_SX, BR_SY);
+			gradSigns8(BL, BL_SX, BL_SY);
+
+			__m256 onef = _mm256_set1_ps(1.0f);
+			__m256 xf1 = _mm256_sub_ps(xf, onef);
+			__m256 yf1 = _mm256_sub_ps(yf, onef);
+			__m256 TR_Val = grad8(TR_SX, TR_SY, xf1, yf1);
+			__m256 TL_Val = grad8(TL_SX, TL_SY, xf, yf1);
+			__m256 BR_Val = grad8(BR_SX, BR_SY, xf1, yf);
+			__m256 BL_Val = grad8(BL_SX, BL_SY, xf, yf);
+
+			__m256 u = fade8(xf);
+			__m256 v = fade8(yf);
+			__m256 interpTop = lerp8(u, TL_Val, TR_Val);
+			__m256 interpBottom = lerp8(u, BL_Val, BR_Val);
+			_mm256_storeu_ps(out, lerp8(v, interpBottom, interpTop));
+
+			if (Derivatives) {
+				__m256 du = fadeDeriv8(xf);
+				__m256 dv = fadeDeriv8(yf);
+				__m256 topDx = _mm256_add_ps(lerp8(u, _mm256_xor_ps(onef, TL_SX), _mm256_xor_ps(onef, TR_SX)), _mm256_mul_ps(du, _mm256_sub_ps(TR_Val, TL_Val)));
+				__m256 bottomDx = _mm256_add_ps(lerp8(u, _mm256_xor_ps(onef, BL_SX), _mm256_xor_ps(onef, BR_SX)), _mm256_mul_ps(du, _mm256_sub_ps(BR_Val, BL_Val)));
+				__m256 topDy = lerp8(u, _mm256_xor_ps(onef, TL_SY), _mm256_xor_ps(onef, TR_SY));
+				__m256 bottomDy = lerp8(u, _mm256_xor_ps(onef, BL_SY), _mm256_xor_ps(onef, BR_SY));
+				_mm256_storeu_ps(dxs, lerp8(v, bottomDx, topDx));
+				_mm256_storeu_ps(dys, _mm256_add_ps(lerp8(v, bottomDy, topDy), _mm256_mul_ps(dv, _mm256_sub_ps(interpTop, interpBottom))));
+			}
+		}
+
+		template <bool Derivatives>
+		void perlinNoise8(const int* p, const float* xs, const float* ys, float* out, float* dxs, float* dys) {
+			__m256 x = _mm256_loadu_ps(xs);
+			__m256 y = _mm256_loadu_ps(ys);
+
+			__m256 fx = _mm256_floor_ps(x);
+			__m256 fy = _mm256_floor_ps(y);
+			__m256i mask = _mm256_set1_epi32(255);
+			__m256i one = _mm256_set1_epi32(1);
+			__m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+			__m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+			__m256 xf = _mm256_sub_ps(x, fx);
+			__m256 yf = _mm256_sub_ps(y, fy);
+
+			__m256i A = _mm256_add_epi32(_mm256_i32gather_epi32(p, X, 4), Y);
+			__m256i B = _mm256_add_epi32(_mm256_i32gather_epi32(p, _mm256_add_epi32(X, one), 4), Y);
+			gradientNoise8<Derivatives>(
+				_mm256_i32gather_epi32(p, _mm256_add_epi32(B, one), 4), _mm256_i32gather_epi32(p, _mm256_add_epi32(A, one), 4),
+				_mm256_i32gather_epi32(p, B, 4), _mm256_i32gather_epi32(p, A, 4),
+				xf, yf, out, dxs, dys);
+		}
+
+		__m256i mixHash8(__m256i h) {
+			h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+			h = _mm256_mullo_epi32(h, _mm256_set1_epi32(int(0x2c1b3c6du)));
+			return _mm256_srli_epi32(h, 29);
+		}
+
+		//the corner hashes are plain integer arithmetic, no gathers
+		template <bool Derivatives>
+		void hashNoise8(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys) {
+			__m256 x = _mm256_loadu_ps(xs);
+			__m256 y = _mm256_loadu_ps(ys);
+
+			__m256 fx = _mm256_floor_ps(x);
+			__m256 fy = _mm256_floor_ps(y);
+			__m256 xf = _mm256_sub_ps(x, fx);
+			__m256 yf = _mm256_sub_ps(y, fy);
+
+			__m256i primeX = _mm256_set1_epi32(int(hashPrimeX));
+			__m256i primeY = _mm256_set1_epi32(int(hashPrimeY));
+			__m256i seeds = _mm256_set1_epi32(int(seed));
+			__m256i X = _mm256_mullo_epi32(_mm256_cvttps_epi32(fx), primeX);
+			__m256i Y = _mm256_mullo_epi32(_mm256_cvttps_epi32(fy), primeY);
+			__m256i X1 = _mm256_add_epi32(X, primeX);
+			__m256i Y1 = _mm256_xor_si256(_mm256_add_epi32(Y, primeY), seeds);
+			Y = _mm256_xor_si256(Y, seeds);
+
+			gradientNoise8<Derivatives>(
+				mixHash8(_mm256_xor_si256(X1, Y1)), mixHash8(_mm256_xor_si256(X, Y1)),
+				mixHash8(_mm256_xor_si256(X1, Y)), mixHash8(_mm256_xor_si256(X, Y)),
+				xf, yf, out, dxs, dys);
+		}
+
+		//the 8 gradient table entries fit one register, so each component is a single permute
+		template <bool Derivatives>
+		__m256 simplexCorner8(__m256i hash, __m256 x, __m256 y, __m256& dx, __m256& dy) {
+			__m256 gx = _mm256_permutevar8x32_ps(_mm256_loadu_ps(simplexGradX), hash);
+			__m256 gy = _mm256_permutevar8x32_ps(_mm256_loadu_ps(simplexGradY), hash);
+			__m256 t = _mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)), _mm256_setzero_ps());
+			__m256 t2 = _mm256_mul_ps(t, t);
+			__m256 t4 = _mm256_mul_ps(t2, t2);
+			__m256 g = _mm256_add_ps(_mm256_mul_ps(gx, x), _mm256_mul_ps(gy, y));
+			if (Derivatives) {
+				__m256 t3g = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t2, t), g), _mm256_set1_ps(8.0f));
+				dx = _mm256_add_ps(dx, _mm256_sub_ps(_mm256_mul_ps(t4, gx), _mm256_mul_ps(t3g, x)));
+				dy = _mm256_add_ps(dy, _mm256_sub_ps(_mm256_mul_ps(t4, gy), _mm256_mul_ps(t3g, y)));
+			}
+			return _mm256_mul_ps(t4, g);
+		}
+
+		template <bool Derivatives>
+		void simplexNoise8(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys) {
+			__m256 x = _mm256_loadu_ps(xs);
+			__m256 y = _mm256_loadu_ps(ys);
+
+			__m256 s = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(simplexSkew));
+			__m256 fi = _mm256_floor_ps(_mm256_add_ps(x, s));
+			__m256 fj = _mm256_floor_ps(_mm256_add_ps(y, s));
+			__m256 t = _mm256_mul_ps(_mm256_add_ps(fi, fj), _mm256_set1_ps(simplexUnskew));
+
+			__m256 onef = _mm256_set1_ps(1.0f);
+			__m256 unskew = _mm256_set1_ps(simplexUnskew);
+			__m256 unskew2 = _mm256_set1_ps(2.0f * simplexUnskew);
+			__m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(fi, t));
+			__m256 y0 = _mm256_sub_ps(y, _mm256_sub_ps(fj, t));
+			__m256 lower = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+			__m256 i1 = _mm256_and_ps(lower, onef);
+			__m256 j1 = _mm256_sub_ps(onef, i1);
+			__m256 x1 = _mm256_add_ps(_mm256_sub_ps(x0, i1), unskew);
+			__m256 y1 = _mm256_add_ps(_mm256_sub_ps(y0, j1), unskew);
+			__m256 x2 = _mm256_add_ps(_mm256_sub_ps(x0, onef), unskew2);
+			__m256 y2 = _mm256_add_ps(_mm256_sub_ps(y0, onef), unskew2);
+
+			__m256i primeX = _mm256_set1_epi32(int(hashPrimeX));
+			__m256i primeY = _mm256_set1_epi32(int(hashPrimeY));
+			__m256i seeds = _mm256_set1_epi32(int(seed));
+			__m256i lowerMask = _mm256_castps_si256(lower);
+			__m256i I = _mm256_mullo_epi32(_mm256_cvttps_epi32(fi), primeX);
+			__m256i J = _mm256_mullo_epi32(_mm256_cvttps_epi32(fj), primeY);
+			__m256i I1 = _mm256_add_epi32(I, _mm256_and_si256(lowerMask, primeX));
+			__m256i J1 = _mm256_add_epi32(J, _mm256_andnot_si256(lowerMask, primeY));
+			__m256i h0 = mixHash8(_mm256_xor_si256(_mm256_xor_si256(seeds, I), J));
+			__m256i h1 = mixHash8(_mm256_xor_si256(_mm256_xor_si256(seeds, I1), J1));
+			__m256i h2 = mixHash8(_mm256_xor_si256(_mm256_xor_si256(seeds, _mm256_add_epi32(I, primeX)), _mm256_add_epi32(J, primeY)));
+
+			__m256 dx = _mm256_setzero_ps(), dy = _mm256_setzero_ps();
+			__m256 n = simplexCorner8<Derivatives>(h0, x0, y0, dx, dy);
+			n = _mm256_add_ps(n, simplexCorner8<Derivatives>(h1, x1, y1, dx, dy));
+			n = _mm256_add_ps(n, simplexCorner8<Derivatives>(h2, x2, y2, dx, dy));
+			__m256 scale = _mm256_set1_ps(simplexScale);
+			_mm256_storeu_ps(out, _mm256_mul_ps(n, scale));
+			if (Derivatives) {
+				_mm256_storeu_ps(dxs, _mm256_mul_ps(dx, scale));
+				_mm256_storeu_ps(dys, _mm256_mul_ps(dy, scale));
+			}
+		}
+	}
+
+	#define TERRAIN_NOISE_KERNEL perlinNoise8
+	#define TERRAIN_SIMPLEX_NOISE_KERNEL simplexNoise8
+	#define TERRAIN_HASH_NOISE_KERNEL hashNoise8
+
+#elif defined(TERRAIN_NOISE_SSE2)
+
+	namespace {
+		constexpr int batchWidth = 4;
+
+		__m128 fade4(__m128 t) {
+			__m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10));
+			return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+		}
+
+		__m128 fadeDeriv4(__m128 t) {
+			__m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(t, _mm_set1_ps(2))), _mm_set1_ps(1));
+			return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(30), t), t), inner);
+		}
+
+		__m128 lerp4(__m128 x, __m128 p1, __m128 p2) {
+			return _mm_add_ps(p1, _mm_mul_ps(x, _mm_sub_ps(p2, p1)));
+		}
+
+		//sign bits of the corner's constant vector, as in gradX()/gradY()
+		void gradSigns4(__m128i hash, __m128& signX, __m128& signY) {
+			__m128i two = _mm_set1_epi32(2);
+			signX = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(hash, _mm_set1_epi32(1)), two), 30));
+			signY = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(hash, two), 30));
+		}
+
+		//flipping the sign bits is the same as multiplying by the +-1 components
+		__m128 grad4(__m128 signX, __m128 signY, __m128 x, __m128 y) {
+			return _mm_add_ps(_mm_xor_ps(x, signX), _mm_xor_ps(y, signY));
+		}
+
+		//SSE2 has no floor, truncate and step down where truncation rounded up (negative inputs)
+		__m128 floor4(__m128 x, __m128i& xi) {
+			__m128i t = _mm_cvttps_epi32(x);
+			__m128 tf = _mm_cvtepi32_ps(t);
+			__m128 roundedUp = _mm_cmpgt_ps(tf, x);
+			xi = _mm_add_epi32(t, _mm_castps_si128(roundedUp)); // mask is -1 where rounded up
+			return _mm_sub_ps(tf, _mm_and_ps(roundedUp, _mm_set1_ps(1.0f)));
+		}
+
+		//gradient noise from the hashes of the four corners, as gradientNoise()
+		template <bool Derivatives>
+		void gradientNoise4(__m128i TR, __m128i TL, __m128i BR, __m128i BL, __m128 xf, __m128 yf, float* out, float* dxs, float* dys) {
+			__m128 TR_SX, TR_SY, TL_SX, TL_SY, BR_SX, BR_SY, BL_SX, BL_SY;
+			gradSigns4(TR, TR_SX, TR_SY);
+			gradSigns4(TL, TL_SX, TL_SY);
+			gradSigns4(BR, BR_SX, BR_SY);
+			gradSigns4(BL, BL_SX, BL_SY);
+
+			__m128 onef = _mm_set1_ps(1.0f);
+			__m128 xf1 = _mm_sub_ps(xf, onef);
+			__m128 yf1 = _mm_sub_ps(yf, onef);
+			__m128 TR_Val = grad4(TR_SX, TR_SY, xf1, yf1);
+			__m128 TL_Val = grad4(TL_SX, TL_SY, xf, yf1);
+			__m128 BR_Val = grad4(BR_SX, BR_SY, xf1, yf);
+			__m128 BL_Val = grad4(BL_SX, BL_SY, xf, yf);
+
+			__m128 u = fade4(xf);
+			__m128 v = fade4(yf);
+			__m128 interpTop = lerp4(u, TL_Val, TR_Val);
+			__m128 interpBottom = lerp4(u, BL_Val, BR_Val);
+			_mm_storeu_ps(out, lerp4(v, interpBottom, interpTop));
+
+			if (Derivatives) {
+				__m128 du = fadeDeriv4(xf);
+				__m128 dv = fadeDeriv4(yf);
+				__m128 topDx = _mm_add_ps(lerp4(u, _mm_xor_ps(onef, TL_SX), _mm_xor_ps(onef, TR_SX)), _mm_mul_ps(du, _mm_sub_ps(TR_Val, TL_Val)));
+				__m128 bottomDx = _mm_add_ps(lerp4(u, _mm_xor_ps(onef, BL_SX), _mm_xor_ps(onef, BR_SX)), _mm_mul_ps(du, _mm_sub_ps(BR_Val, BL_Val)));
+				__m128 topDy = lerp4(u, _mm_xor_ps(onef, TL_SY), _mm_xor_ps(onef, TR_SY));
+				__m128 bottomDy = lerp4(u, _mm_xor_ps(onef, BL_SY), _mm_xor_ps(onef, BR_SY));
+				_mm_storeu_ps(dxs, lerp4(v, bottomDx, topDx));
+				_mm_storeu_ps(dys, _mm_add_ps(lerp4(v, bottomDy, topDy), _mm_mul_ps(dv, _mm_sub_ps(interpTop, interpBottom))));
+			}
+		}
+
+		template <bool Derivatives>
+		void perlinNoise4(const int* p, const float* xs, const float* ys, float* out, float* dxs, float* dys) {
+			__m128 x = _mm_loadu_ps(xs);
+			__m128 y = _mm_loadu_ps(ys);
+
+			__m128i xi, yi;
+			__m128 fx = floor4(x, xi);
+			__m128 fy = floor4(y, yi);
+			__m128i mask = _mm_set1_epi32(255);
+			alignas(16) int X[4], Y[4];
+			_mm_store_si128((__m128i*)X, _mm_and_si128(xi, mask));
+			_mm_store_si128((__m128i*)Y, _mm_and_si128(yi, mask));
+			__m128 xf = _mm_sub_ps(x, fx);
+			__m128 yf = _mm_sub_ps(y, fy);
+
+			//no gathers in SSE2, look the hashes up per lane
+			alignas(16) int TR[4], TL[4], BR[4], BL[4];
+			for (int k = 0; k < 4; k++) {
+				int A = p[X[k]] + Y[k];
+				int B = p[X[k] + 1] + Y[k];
+				TR[k] = p[B + 1];
+				TL[k] = p[A + 1];
+				BR[k] = p[B];
+				BL[k] = p[A];
+			}
+
+			gradientNoise4<Derivatives>(
+				_mm_load_si128((const __m128i*)TR), _mm_load_si128((const __m128i*)TL),
+				_mm_load_si128((const __m128i*)BR), _mm_load_si128((const __m128i*)BL),
+				xf, yf, out, dxs, dys);
+		}
+
+		//SSE2 only multiplies every other 32 bit lane, so the even and odd lanes are done separately
+		__m128i mullo4(__m128i a, __m128i b) {
+			__m128i even = _mm_mul_epu32(a, b);
+			__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+			return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+		}
+
+		__m128i mixHash4(__m128i h) {
+			h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+			h = mullo4(h, _mm_set1_epi32(int(0x2c1b3c6du)));
+			return _mm_srli_epi32(h, 29);
+		}
+
+		//the corner hashes are plain integer arithmetic, no per lane table lookups
+		template <bool Derivatives>
+		void hashNoise4(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys) {
+			__m128 x = _mm_loadu_ps(xs);
+			__m128 y = _mm_loadu_ps(ys);
+
+			__m128i xi, yi;
+			__m128 fx = floor4(x, xi);
+			__m128 fy = floor4(y, yi);
+			__m128 xf = _mm_sub_ps(x, fx);
+			__m128 yf = _mm_sub_ps(y, fy);
+
+			__m128i primeX = _mm_set1_epi32(int(hashPrimeX));
+			__m128i primeY = _mm_set1_epi32(int(hashPrimeY));
+			__m128i seeds = _mm_set1_epi32(int(seed));
+			__m128i X = mullo4(xi, primeX);
+			__m128i Y = mullo4(yi, primeY);
+			__m128i X1 = _mm_add_epi32(X, primeX);
+			__m128i Y1 = _mm_xor_si128(_mm_add_epi32(Y, primeY), seeds);
+			Y = _mm_xor_si128(Y, seeds);
+
+			gradientNoise4<Derivatives>(
+				mixHash4(_mm_xor_si128(X1, Y1)), mixHash4(_mm_xor_si128(X, Y1)),
+				mixHash4(_mm_xor_si128(X1, Y)), mixHash4(_mm_xor_si128(X, Y)),
+				xf, yf, out, dxs, dys);
+		}
+
+		//SSE2 has no variable permute, the gradients are looked up per lane
+		template <bool Derivatives>
+		__m128 simplexCorner4(__m128i hash, __m128 x, __m128 y, __m128& dx, __m128& dy) {
+			alignas(16) int h[4];
+			_mm_store_si128((__m128i*)h, hash);
+			__m128 gx = _mm_setr_ps(simplexGradX[h[0]], simplexGradX[h[1]], simplexGradX[h[2]], simplexGradX[h[3]]);
+			__m128 gy = _mm_setr_ps(simplexGradY[h[0]], simplexGradY[h[1]], simplexGradY[h[2]], simplexGradY[h[3]]);
+			__m128 t = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_setzero_ps());
+			__m128 t2 = _mm_mul_ps(t, t);
+			__m128 t4 = _mm_mul_ps(t2, t2);
+			__m128 g = _mm_add_ps(_mm_mul_ps(gx, x), _mm_mul_ps(gy, y));
+			if (Derivatives) {
+				__m128 t3g = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t2, t), g), _mm_set1_ps(8.0f));
+				dx = _mm_add_ps(dx, _mm_sub_ps(_mm_mul_ps(t4, gx), _mm_mul_ps(t3g, x)));
+				dy = _mm_add_ps(dy, _mm_sub_ps(_mm_mul_ps(t4, gy), _mm_mul_ps(t3g, y)));
+			}
+			return _mm_mul_ps(t4, g);
+		}
+
+		template <bool Derivatives>
+		void simplexNoise4(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys) {
+			__m128 x = _mm_loadu_ps(xs);
+			__m128 y = _mm_loadu_ps(ys);
+
+			__m128 s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(simplexSkew));
+			__m128i ii, ji;
+			__m128 fi = floor4(_mm_add_ps(x, s), ii);
+			__m128 fj = floor4(_mm_add_ps(y, s), ji);
+			__m128 t = _mm_mul_ps(_mm_add_ps(fi, fj), _mm_set1_ps(simplexUnskew));
+
+			__m128 onef = _mm_set1_ps(1.0f);
+			__m128 unskew = _mm_set1_ps(simplexUnskew);
+			__m128 unskew2 = _mm_set1_ps(2.0f * simplexUnskew);
+			__m128 x0 = _mm_sub_ps(x, _mm_sub_ps(fi, t));
+			__m128 y0 = _mm_sub_ps(y, _mm_sub_ps(fj, t));
+			__m128 lower = _mm_cmpgt_ps(x0, y0);
+			__m128 i1 = _mm_and_ps(lower, onef);
+			__m128 j1 = _mm_sub_ps(onef, i1);
+			__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, i1), unskew);
+			__m128 y1 = _mm_add_ps(_mm_sub_ps(y0, j1), unskew);
+			__m128 x2 = _mm_add_ps(_mm_sub_ps(x0, onef), unskew2);
+			__m128 y2 = _mm_add_ps(_mm_sub_ps(y0, onef), unskew2);
+
+			__m128i primeX = _mm_set1_epi32(int(hashPrimeX));
+			__m128i primeY = _mm_set1_epi32(int(hashPrimeY));
+			__m128i seeds = _mm_set1_epi32(int(seed));
+			__m128i lowerMask = _mm_castps_si128(lower);
+			__m128i I = mullo4(ii, primeX);
+			__m128i J = mullo4(ji, primeY);
+			__m128i I1 = _mm_add_epi32(I, _mm_and_si128(lowerMask, primeX));
+			__m128i J1 = _mm_add_epi32(J, _mm_andnot_si128(lowerMask, primeY));
+			__m128i h0 = mixHash4(_mm_xor_si128(_mm_xor_si128(seeds, I), J));
+			__m128i h1 = mixHash4(_mm_xor_si128(_mm_xor_si128(seeds, I1), J1));
+			__m128i h2 = mixHash4(_mm_xor_si128(_mm_xor_si128(seeds, _mm_add_epi32(I, primeX)), _mm_add_epi32(J, primeY)));
+
+			__m128 dx = _mm_setzero_ps(), dy = _mm_setzero_ps();
+			__m128 n = simplexCorner4<Derivatives>(h0, x0, y0, dx, dy);
+			n = _mm_add_ps(n, simplexCorner4<Derivatives>(h1, x1, y1, dx, dy));
+			n = _mm_add_ps(n, simplexCorner4<Derivatives>(h2, x2, y2, dx, dy));
+			__m128 scale = _mm_set1_ps(simplexScale);
+			_mm_storeu_ps(out, _mm_mul_ps(n, scale));
+			if (Derivatives) {
+				_mm_storeu_ps(dxs, _mm_mul_ps(dx, scale));
+				_mm_storeu_ps(dys, _mm_mul_ps(dy, scale));
+			}
+		}
+	}
+
+	#define TERRAIN_NOISE_KERNEL perlinNoise4
+	#define TERRAIN_SIMPLEX_NOISE_KERNEL simplexNoise4
+	#define TERRAIN_HASH_NOISE_KERNEL hashNoise4
+
+#else
+
+	namespace {
+		constexpr int batchWidth = 1;
+	}
+
+#endif
+
+
+	namespace {
+		template <bool Derivatives>
+		void perlinNoiseBatchImpl(const PermutationTable& perm, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n) {
+			std::size_t i = 0;
+#ifdef TERRAIN_NOISE_KERNEL
+			for (; i + batchWidth <= n; i += batchWidth) {
+				TERRAIN_NOISE_KERNEL<Derivatives>(perm.p, xs + i, ys + i, out + i, dxs + i, dys + i);
+			}
+#endif
+			//remaining samples that don't fill a whole simd register
+			for (; i < n; i++) {
+				out[i] = perlinNoiseImpl<Derivatives>(perm.p, xs[i], ys[i], dxs + i, dys + i);
+			}
+		}
+
+		template <bool Derivatives>
+		void hashNoiseBatchImpl(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n) {
+			std::size_t i = 0;
+#ifdef TERRAIN_HASH_NOISE_KERNEL
+			for (; i + batchWidth <= n; i += batchWidth) {
+				TERRAIN_HASH_NOISE_KERNEL<Derivatives>(seed, xs + i, ys + i, out + i, dxs + i, dys + i);
+			}
+#endif
+			for (; i < n; i++) {
+				out[i] = hashNoiseImpl<Derivatives>(seed, xs[i], ys[i], dxs + i, dys + i);
+			}
+		}
+
+		template <bool Derivatives>
+		void simplexNoiseBatchImpl(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n) {
+			std::size_t i = 0;
+#ifdef TERRAIN_SIMPLEX_NOISE_KERNEL
+			for (; i + batchWidth <= n; i += batchWidth) {
+				TERRAIN_SIMPLEX_NOISE_KERNEL<Derivatives>(seed, xs + i, ys + i, out + i, dxs + i, dys + i);
+			}
+#endif
+			for (; i < n; i++) {
+				out[i] = simplexNoiseImpl<Derivatives>(seed, xs[i], ys[i], dxs + i, dys + i);
+			}
+		}
+	}
+
+	void perlinNoiseBatch(const PermutationTable& perm, const float* xs, const float* ys, float* out, std::size_t n) {
+		perlinNoiseBatchImpl<false>(perm, xs, ys, out, nullptr, nullptr, n);
+	}
+
+	void perlinNoiseBatch(const PermutationTable& perm, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n) {
+		perlinNoiseBatchImpl<true>(perm, xs, ys, out, dxs, dys, n);
+	}
+
+	int perlinNoiseBatchWidth() {
+		return batchWidth;
+	}
+
+
+	void hashNoiseBatch(std::uint32_t seed, const float* xs, const float* ys, float* out, std::size_t n) {
+		hashNoiseBatchImpl<false>(seed, xs, ys, out, nullptr, nullptr, n);
+	}
+
+	void hashNoiseBatch(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n) {
+		hashNoiseBatchImpl<true>(seed, xs, ys, out, dxs, dys, n);
+	}
+
+	void simplexNoiseBatch(std::uint32_t seed, const float* xs, const float* ys, float* out, std::size_t n) {
+		simplexNoiseBatchImpl<false>(seed, xs, ys, out, nullptr, nullptr, n);
+	}
+
+	void simplexNoiseBatch(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n) {
+		simplexNoiseBatchImpl<true>(seed, xs, ys, out, dxs, dys, n);
+	}
+
+
+	void noiseBatch(NoiseBasis basis, const PermutationTable& perm, const float* xs, const float* ys, float* out, std::size_t n) {
+		switch (basis) {
+		case NoiseBasis::Hash: hashNoiseBatch(perm.hashSeed, xs, ys, out, n); break;
+		case NoiseBasis::Simplex: simplexNoiseBatch(perm.hashSeed, xs, ys, out, n); break;
+		default: perlinNoiseBatch(perm, xs, ys, out, n); break;
+		}
+	}
+
+	void noiseBatch(NoiseBasis basis, const PermutationTable& perm, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n) {
+		switch (basis) {
+		case NoiseBasis::Hash: hashNoiseBatch(perm.hashSeed, xs, ys, out, dxs, dys, n); break;
+		case NoiseBasis::Simplex: simplexNoiseBatch(perm.hashSeed, xs, ys, out, dxs, dys, n); break;
+		default: perlinNoiseBatch(perm, xs, ys, out, dxs, dys, n); break;
+		}
+	}
+}
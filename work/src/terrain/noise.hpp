@@ -0,0 +1,80 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace terrain {
+
+	// Ken Perlin's reference permutation of 0..255, the table every terrain starts from
+	extern const int referencePermutations[256];
+
+	// Lattice noise the fractals are built from.
+	enum class NoiseBasis : int {
+		Perlin = 0,	// classic Perlin noise on the permutation table, repeats every 256 units
+		Hash = 1,	// gradient noise on an integer hash of the lattice point and seed, doesn't repeat
+		Simplex = 2	// simplex noise with the same hash, 3 corners per sample instead of 4
+	};
+
+	// Perlin's permutation table doubled to 512 entries (p[i] == p[i + 256]), so corner hashes
+	// can be looked up as p[p[X] + Y] without wrapping the intermediate sums.
+	struct PermutationTable {
+		int p[512];
+		std::uint32_t hashSeed = 0; // seeds hashNoise, so one table stands for every basis of a seed
+
+		PermutationTable() = default;
+		explicit PermutationTable(const int(&permutations)[256]);
+	};
+
+
+	// Classic 2D Perlin noise in [-1, 1].
+	// Identical to the original TerrainRenderer::perlinNoise for x, y >= 0 (which is all the
+	// terrain ever samples); negative coordinates are floored instead of being undefined.
+	float perlinNoise(const PermutationTable& perm, float x, float y);
+
+	// Perlin noise that also returns its analytic partial derivatives d/dx and d/dy.
+	// The returned value is identical to perlinNoise(perm, x, y).
+	float perlinNoise(const PermutationTable& perm, float x, float y, float& dx, float& dy);
+
+	// Evaluates n Perlin noise samples at (xs[i], ys[i]) into out[i].
+	// Uses 8 wide AVX2 when compiled with it (CGRA_ENABLE_AVX2), 4 wide SSE2 otherwise on x86 and
+	// a plain loop on other targets. Every path uses the same operations in the same order as
+	// perlinNoise() so results match it exactly; only a compiler contracting the scalar path into
+	// fused multiply-adds (not enabled by our flags) could make them differ, by at most ~1e-6.
+	void perlinNoiseBatch(const PermutationTable& perm, const float* xs, const float* ys, float* out, std::size_t n);
+
+	// batched noise plus analytic derivatives (dxs[i], dys[i])
+	void perlinNoiseBatch(const PermutationTable& perm, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n);
+
+	// number of samples the batch kernel processes per step (8, 4 or 1)
+	int perlinNoiseBatchWidth();
+
+
+	// Gradient noise in [-1, 1] with the same gradients and interpolation as perlinNoise, but each
+	// corner's gradient is picked by an integer hash of its lattice coordinates and the seed instead
+	// of permutation table lookups. The batch kernels need no gathers, any seed works without
+	// building a table, and the pattern doesn't tile every 256 units (the 32 bit lattice
+	// coordinates only wrap far beyond where float samples are still distinct).
+	float hashNoise(std::uint32_t seed, float x, float y);
+	float hashNoise(std::uint32_t seed, float x, float y, float& dx, float& dy);
+
+	// batched like perlinNoiseBatch, every path gives exactly the scalar hashNoise() results
+	void hashNoiseBatch(std::uint32_t seed, const float* xs, const float* ys, float* out, std::size_t n);
+	void hashNoiseBatch(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n);
+
+	// 2D simplex noise in about [-1, 1]. Samples sum 3 corners of a triangle grid with a radial
+	// falloff instead of fading between 4 square corners, which is cheaper per sample and has no
+	// axis aligned artifacts. Corner gradients come from the same integer hash as hashNoise, but
+	// pick one of 8 directions 45 degrees apart instead of the 4 diagonals, so the noise has no
+	// ridges along the diagonals either.
+	float simplexNoise(std::uint32_t seed, float x, float y);
+	float simplexNoise(std::uint32_t seed, float x, float y, float& dx, float& dy);
+
+	// batched like perlinNoiseBatch, every path gives exactly the scalar simplexNoise() results
+	void simplexNoiseBatch(std::uint32_t seed, const float* xs, const float* ys, float* out, std::size_t n);
+	void simplexNoiseBatch(std::uint32_t seed, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n);
+
+	// batched noise of the given basis, hash and simplex noise are seeded with perm.hashSeed
+	void noiseBatch(NoiseBasis basis, const PermutationTable& perm, const float* xs, const float* ys, float* out, std::size_t n);
+	void noiseBatch(NoiseBasis basis, const PermutationTable& perm, const float* xs, const float* ys, float* out, float* dxs, float* dys, std::size_t n);
+}
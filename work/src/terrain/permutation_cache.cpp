@@ -0,0 +1,78 @@
+
+// std
+#include <algorithm>
+
+// project
+#include "permutation_cache.hpp"
+
+
+namespace terrain {
+
+	namespace {
+		// splitmix64, small and fully specified so seeds are portable
+		std::uint64_t nextRandom(std::uint64_t& state) {
+			std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+	}
+
+
+	PermutationTable makePermutationTable(std::uint64_t seed) {
+		int permutations[256];
+		std::copy(referencePermutations, referencePermutations + 256, permutations);
+
+		if (seed != 0) {
+			std::uint64_t state = seed;
+			for (int i = 255; i > 0; i--) {
+				// multiply-shift maps the 64 bit value onto [0, i] without a modulo
+				int j = int(((nextRandom(state) >> 32) * std::uint64_t(i + 1)) >> 32);
+				std::swap(permutations[i], permutations[j]);
+			}
+		}
+		PermutationTable table(permutations);
+		//hash noise seed, 0 for the reference table like the permutation
+		std::uint64_t state = seed;
+		table.hashSeed = seed != 0 ? std::uint32_t(nextRandom(state) >> 32) : 0;
+		return table;
+	}
+
+
+	PermutationCache::PermutationCache(std::size_t capacity) : m_capacity(std::max<std::size_t>(capacity, 1)) { }
+
+
+	std::shared_ptr<const PermutationTable> PermutationCache::get(std::uint64_t seed) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& e) { return e.first == seed; });
+		if (it != m_entries.end()) {
+			m_entries.splice(m_entries.begin(), m_entries, it);
+			return it->second;
+		}
+
+		if (m_entries.size() >= m_capacity) {
+			m_entries.pop_back();
+		}
+		m_entries.emplace_front(seed, std::make_shared<const PermutationTable>(makePermutationTable(seed)));
+		return m_entries.front().second;
+	}
+
+
+	std::size_t PermutationCache::size() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries.size();
+	}
+
+
+	void PermutationCache::clear() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.clear();
+	}
+
+
+	PermutationCache& PermutationCache::shared() {
+		static PermutationCache cache;
+		return cache;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// project
+#include "noise.hpp"
+
+namespace terrain {
+
+	// Permutation table for a 64 bit seed.
+	// Seed 0 is Perlin's reference permutation; any other seed is a Fisher-Yates shuffle of it
+	// driven by splitmix64, so a seed gives the same table on every platform and standard library.
+	// The table's hashSeed (for hashNoise) is derived from the seed the same way.
+	PermutationTable makePermutationTable(std::uint64_t seed);
+
+
+	// Thread-safe least recently used cache of expanded permutation tables keyed by seed, so
+	// switching between known seeds is a lookup instead of rebuilding the table.
+	// Tables are handed out as shared pointers and stay valid after they are evicted.
+	class PermutationCache {
+	public:
+		explicit PermutationCache(std::size_t capacity = 16);
+
+		PermutationCache(const PermutationCache&) = delete;
+		PermutationCache& operator=(const PermutationCache&) = delete;
+
+		// returns the table for seed, building it if it isn't cached
+		std::shared_ptr<const PermutationTable> get(std::uint64_t seed);
+
+		std::size_t size() const;
+		std::size_t capacity() const { return m_capacity; }
+		void clear();
+
+		// cache shared by the terrain code
+		static PermutationCache& shared();
+
+	private:
+		using Entry = std::pair<std::uint64_t, std::shared_ptr<const PermutationTable>>;
+
+		std::size_t m_capacity;
+		std::list<Entry> m_entries; // most recently used first
+		mutable std::mutex m_mutex;
+	};
+}
@@ -0,0 +1,272 @@
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// project
+#include "pipe_erosion.hpp"
+#include "erosion.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TERRAIN_PIPE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_PIPE_SSE2
+#endif
+
+
+namespace terrain {
+
+	namespace {
+
+		const int rowsPerBand = 16;
+
+		//one cell is one unit across, the pipes between cells have unit cross section
+		const float timeStep = 0.05f;
+		const float gravity = 9.81f;
+		const float flowRate = timeStep * gravity; //flux gained per unit of surface height difference
+		const float minDepth = 0.001f; //velocity of (nearly) dry cells is worked out against this depth
+		const float minTilt = 0.05f; //flat ground still carries some sediment
+
+
+		//The row kernels are written once against a lane type, run a vector at a time across the
+		//row and then one float at a time for the remainder. The operators and helpers below have
+		//the same meaning for float and for the SIMD lanes
+		inline float vmin(float a, float b) { return std::min(a, b); }
+		inline float vmax(float a, float b) { return std::max(a, b); }
+		inline float vsqrt(float a) { return std::sqrt(a); }
+		inline float load(const float* p, float) { return *p; }
+		inline void store(float* p, float v) { *p = v; }
+
+#if defined(TERRAIN_PIPE_AVX2)
+		struct Lanes {
+			static const int width = 8;
+			__m256 v;
+			Lanes() = default;
+			Lanes(__m256 v) : v(v) {}
+			Lanes(float f) : v(_mm256_set1_ps(f)) {}
+		};
+		inline Lanes operator+(Lanes a, Lanes b) { return _mm256_add_ps(a.v, b.v); }
+		inline Lanes operator-(Lanes a, Lanes b) { return _mm256_sub_ps(a.v, b.v); }
+		inline Lanes operator*(Lanes a, Lanes b) { return _mm256_mul_ps(a.v, b.v); }
+		inline Lanes operator/(Lanes a, Lanes b) { return _mm256_div_ps(a.v, b.v); }
+		inline Lanes vmin(Lanes a, Lanes b) { return _mm256_min_ps(a.v, b.v); }
+		inline Lanes vmax(Lanes a, Lanes b) { return _mm256_max_ps(a.v, b.v); }
+		inline Lanes vsqrt(Lanes a) { return _mm256_sqrt_ps(a.v); }
+		inline Lanes load(const float* p, Lanes) { return _mm256_loadu_ps(p); }
+		inline void store(float* p, Lanes v) { _mm256_storeu_ps(p, v.v); }
+#define TERRAIN_PIPE_LANES
+
+#elif defined(TERRAIN_PIPE_SSE2)
+		struct Lanes {
+			static const int width = 4;
+			__m128 v;
+			Lanes() = default;
+			Lanes(__m128 v) : v(v) {}
+			Lanes(float f) : v(_mm_set1_ps(f)) {}
+		};
+		inline Lanes operator+(Lanes a, Lanes b) { return _mm_add_ps(a.v, b.v); }
+		inline Lanes operator-(Lanes a, Lanes b) { return _mm_sub_ps(a.v, b.v); }
+		inline Lanes operator*(Lanes a, Lanes b) { return _mm_mul_ps(a.v, b.v); }
+		inline Lanes operator/(Lanes a, Lanes b) { return _mm_div_ps(a.v, b.v); }
+		inline Lanes vmin(Lanes a, Lanes b) { return _mm_min_ps(a.v, b.v); }
+		inline Lanes vmax(Lanes a, Lanes b) { return _mm_max_ps(a.v, b.v); }
+		inline Lanes vsqrt(Lanes a) { return _mm_sqrt_ps(a.v); }
+		inline Lanes load(const float* p, Lanes) { return _mm_loadu_ps(p); }
+		inline void store(float* p, Lanes v) { _mm_storeu_ps(p, v.v); }
+#define TERRAIN_PIPE_LANES
+#endif
+
+		//calls kernel(x, lanes) for x in [0, width), with a Lanes value while a full vector fits and
+		//a float after that. The value only selects the type
+		template <typename Kernel>
+		void forEachLane(int width, Kernel kernel) {
+			int x = 0;
+#if defined(TERRAIN_PIPE_LANES)
+			for (; x + Lanes::width <= width; x += Lanes::width) kernel(x, Lanes());
+#endif
+			for (; x < width; x++) kernel(x, 0.0f);
+		}
+
+
+		//accelerates the outflow of every cell by the drop in water surface to each neighbour, then
+		//scales it down so no more water leaves than the cell holds (with this step's rain)
+		void updateFlux(int y, int width, ConstHeightfieldView heightMap, ConstHeightfieldView water, Heightfield& left, Heightfield& right,
+			Heightfield& down, Heightfield& up, float rain) {
+
+			const float* b = heightMap.row(y);
+			const float* bDown = heightMap.row(y - 1);
+			const float* bUp = heightMap.row(y + 1);
+			const float* d = water.row(y);
+			const float* dDown = water.row(y - 1);
+			const float* dUp = water.row(y + 1);
+			float* fl = left.row(y);
+			float* fr = right.row(y);
+			float* fd = down.row(y);
+			float* fu = up.row(y);
+
+			forEachLane(width, [&](int x, auto lanes) {
+				using V = decltype(lanes);
+				//rain falls everywhere alike, so it only changes the water a cell has to give
+				V surface = load(b + x, lanes) + load(d + x, lanes);
+				V outLeft = vmax(V(0), load(fl + x, lanes) + V(flowRate) * (surface - load(b + x - 1, lanes) - load(d + x - 1, lanes)));
+				V outRight = vmax(V(0), load(fr + x, lanes) + V(flowRate) * (surface - load(b + x + 1, lanes) - load(d + x + 1, lanes)));
+				V outDown = vmax(V(0), load(fd + x, lanes) + V(flowRate) * (surface - load(bDown + x, lanes) - load(dDown + x, lanes)));
+				V outUp = vmax(V(0), load(fu + x, lanes) + V(flowRate) * (surface - load(bUp + x, lanes) - load(dUp + x, lanes)));
+
+				V total = (outLeft + outRight + outDown + outUp) * V(timeStep);
+				V scale = vmin(V(1), (load(d + x, lanes) + V(rain)) / vmax(total, V(1e-12f)));
+				store(fl + x, outLeft * scale);
+				store(fr + x, outRight * scale);
+				store(fd + x, outDown * scale);
+				store(fu + x, outUp * scale);
+			});
+		}
+
+
+		//dissolves terrain into the water up to its capacity, which grows with the tilt and the
+		//speed of the flow, or deposits what it can't carry. The terrain change is only recorded,
+		//the neighbours still need the old slope. The sediment is kept as a share of the water
+		//(with this step's rain), which is how it leaves with the flow
+		void erodeDeposit(int y, int width, ConstHeightfieldView heightMap, ConstHeightfieldView water, ConstHeightfieldView sediment,
+			const Heightfield& velocityX, const Heightfield& velocityY, Heightfield& dissolved, Heightfield& concentration, const ErosionParams& params) {
+
+			const float* b = heightMap.row(y);
+			const float* bDown = heightMap.row(y - 1);
+			const float* bUp = heightMap.row(y + 1);
+			const float* d = water.row(y);
+			const float* s = sediment.row(y);
+			const float* u = velocityX.row(y);
+			const float* v = velocityY.row(y);
+			float* change = dissolved.row(y);
+			float* c = concentration.row(y);
+
+			forEachLane(width, [&](int x, auto lanes) {
+				using V = decltype(lanes);
+				V gx = (load(b + x + 1, lanes) - load(b + x - 1, lanes)) * V(0.5f);
+				V gy = (load(bUp + x, lanes) - load(bDown + x, lanes)) * V(0.5f);
+				V slope2 = gx * gx + gy * gy;
+				V tilt = vmax(V(minTilt), vsqrt(slope2 / (V(1) + slope2)));
+
+				V vx = load(u + x, lanes);
+				V vy = load(v + x, lanes);
+				V capacity = V(params.kc) * tilt * vsqrt(vx * vx + vy * vy);
+
+				V suspended = load(s + x, lanes);
+				V amount = V(params.ks) * (capacity - suspended);
+				store(change + x, amount);
+				store(c + x, (suspended + amount) / vmax(load(d + x, lanes) + V(params.kr), V(minDepth)));
+			});
+		}
+
+
+		//moves the water, and the sediment in it, by the difference of in and outflow, works out
+		//the velocity from the average flux through the cell and evaporates. Takes the terrain change
+		void moveWater(int y, int width, HeightfieldView heightMap, HeightfieldView water, HeightfieldView sediment, const Heightfield& left,
+			const Heightfield& right, const Heightfield& down, const Heightfield& up, Heightfield& velocityX, Heightfield& velocityY,
+			const Heightfield& dissolved, const Heightfield& concentration, const ErosionParams& params) {
+
+			float* b = heightMap.row(y);
+			float* d = water.row(y);
+			float* s = sediment.row(y);
+			const float* fl = left.row(y);
+			const float* fr = right.row(y);
+			const float* fd = down.row(y);
+			const float* fu = up.row(y);
+			const float* fuBelow = up.row(y - 1); //flows up into this row
+			const float* fdAbove = down.row(y + 1); //flows down into this row
+			float* u = velocityX.row(y);
+			float* v = velocityY.row(y);
+			const float* change = dissolved.row(y);
+			const float* c = concentration.row(y);
+			const float* cBelow = concentration.row(y - 1);
+			const float* cAbove = concentration.row(y + 1);
+
+			forEachLane(width, [&](int x, auto lanes) {
+				using V = decltype(lanes);
+				V fromLeft = load(fr + x - 1, lanes);
+				V fromRight = load(fl + x + 1, lanes);
+				V fromBelow = load(fuBelow + x, lanes);
+				V fromAbove = load(fdAbove + x, lanes);
+				V toLeft = load(fl + x, lanes);
+				V toRight = load(fr + x, lanes);
+				V toDown = load(fd + x, lanes);
+				V toUp = load(fu + x, lanes);
+
+				V before = load(d + x, lanes) + V(params.kr);
+				V inflow = fromLeft + fromRight + fromBelow + fromAbove;
+				V outflow = toLeft + toRight + toDown + toUp;
+				V after = vmax(V(0), before + V(timeStep) * (inflow - outflow));
+				store(d + x, after * V(1 - params.ke));
+
+				V kept = vmax(V(0), before - V(timeStep) * outflow);
+				V carried = load(c + x - 1, lanes) * fromLeft + load(c + x + 1, lanes) * fromRight
+					+ load(cBelow + x, lanes) * fromBelow + load(cAbove + x, lanes) * fromAbove;
+				store(s + x, load(c + x, lanes) * kept + V(timeStep) * carried);
+				store(b + x, load(b + x, lanes) - load(change + x, lanes));
+
+				V depth = vmax((before + after) * V(0.5f), V(minDepth));
+				store(u + x, (fromLeft - toLeft + toRight - fromRight) * V(0.5f) / depth);
+				store(v + x, (fromBelow - toDown + toUp - fromAbove) * V(0.5f) / depth);
+			});
+		}
+
+
+		void resize(Heightfield& field, int width, int height) {
+			if (field.width() != width || field.height() != height || field.border() < 1) {
+				field = Heightfield(width, height, 1);
+			}
+		}
+	}
+
+
+	void PipeErosion::step(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, const ErosionParams& params,
+		ThreadPool& pool) {
+
+		const int width = heightMap.width;
+		const int height = heightMap.height;
+		assert(waterVolume.width == width && waterVolume.height == height);
+		assert(sedimentVolume.width == width && sedimentVolume.height == height);
+
+		//the flux borders stay 0, nothing flows in from outside the map
+		if (m_fluxLeft.width() != width || m_fluxLeft.height() != height) {
+			m_fluxLeft = Heightfield(width, height, 1);
+			m_fluxRight = Heightfield(width, height, 1);
+			m_fluxDown = Heightfield(width, height, 1);
+			m_fluxUp = Heightfield(width, height, 1);
+		}
+		resize(m_velocityX, width, height);
+		resize(m_velocityY, width, height);
+		resize(m_dissolved, width, height);
+		resize(m_concentration, width, height);
+
+		//every pass only writes its own cells, and reads the neighbours of the pass before
+		pool.parallelFor(0, height, rowsPerBand, [&](int yBegin, int yEnd) {
+			for (int y = yBegin; y < yEnd; y++) {
+				updateFlux(y, width, heightMap, waterVolume, m_fluxLeft, m_fluxRight, m_fluxDown, m_fluxUp, params.kr);
+			}
+		});
+		pool.parallelFor(0, height, rowsPerBand, [&](int yBegin, int yEnd) {
+			for (int y = yBegin; y < yEnd; y++) {
+				erodeDeposit(y, width, heightMap, waterVolume, sedimentVolume, m_velocityX, m_velocityY, m_dissolved, m_concentration, params);
+			}
+		});
+		pool.parallelFor(0, height, rowsPerBand, [&](int yBegin, int yEnd) {
+			for (int y = yBegin; y < yEnd; y++) {
+				moveWater(y, width, heightMap, waterVolume, sedimentVolume, m_fluxLeft, m_fluxRight, m_fluxDown, m_fluxUp, m_velocityX, m_velocityY,
+					m_dissolved, m_concentration, params);
+			}
+		});
+	}
+
+
+	void PipeErosion::reset() {
+		m_fluxLeft.fill(0);
+		m_fluxRight.fill(0);
+		m_fluxDown.fill(0);
+		m_fluxUp.fill(0);
+		m_velocityX.fill(0);
+		m_velocityY.fill(0);
+	}
+}
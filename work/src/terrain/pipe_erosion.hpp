@@ -0,0 +1,47 @@
+#pragma once
+
+// project
+#include "heightfield.hpp"
+#include "thread_pool.hpp"
+
+namespace terrain {
+
+	struct ErosionParams;
+
+	// Shallow water hydraulic erosion on the virtual pipe model (Mei, Decaudin and Hu, "Fast
+	// Hydraulic Erosion Simulation and Visualization on GPU", 2007).
+	// Every cell keeps the outflow through pipes to its 4 neighbours. A step rains kr on every
+	// cell, accelerates the flux by the difference in water surface height, dissolves ks of the
+	// difference between the sediment capacity (kc * tilt * speed of the last flow) and the
+	// suspended sediment (or deposits it when negative), moves the water with the sediment in it
+	// through the pipes, works out the new velocity from the flux and evaporates ke of the water.
+	// The sediment leaves a cell as the share of its water that flows out, instead of being
+	// traced back along the velocity (semi-Lagrangian), which loses sediment wherever the flow
+	// spreads out or speeds up; this way only what flows off the map is lost.
+	// Each field is its own array, processed a row at a time by SIMD kernels in row bands on a
+	// thread pool, so the result is the same for any number of threads.
+	// The border of the height map is ground the water can flow out to, and is lost there.
+	class PipeErosion {
+	public:
+		// One step over the interior of the height map, in place. The fields need a border of at
+		// least one cell. waterVolume and sedimentVolume must have the same size as the height map
+		// with zero borders, and carry over between steps like the flow kept here. The flow is
+		// reset (and reallocated) when the size changes, so steps on the same map don't allocate.
+		void step(HeightfieldView heightMap, HeightfieldView waterVolume, HeightfieldView sedimentVolume, const ErosionParams& params,
+			ThreadPool& pool = ThreadPool::shared());
+
+		// back to still water, for starting again on another terrain
+		void reset();
+
+	private:
+		// outflow to (x - 1, y), (x + 1, y), (x, y - 1) and (x, y + 1)
+		Heightfield m_fluxLeft;
+		Heightfield m_fluxRight;
+		Heightfield m_fluxDown;
+		Heightfield m_fluxUp;
+		Heightfield m_velocityX;
+		Heightfield m_velocityY;
+		Heightfield m_dissolved; // terrain turned into sediment this step, negative where deposited
+		Heightfield m_concentration; // sediment per unit of water, what the flow carries along
+	};
+}
@@ -0,0 +1,148 @@
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+// project
+#include "thread_pool.hpp"
+
+
+namespace terrain {
+
+	ThreadPool::ThreadPool(unsigned numThreads) {
+		if (numThreads == 0) {
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		// the thread calling parallelFor does a share of the work as well
+		for (unsigned i = 1; i < numThreads; i++) {
+			m_workers.emplace_back([this] { workerLoop(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_taskAvailable.notify_all();
+		for (std::thread& worker : m_workers) {
+			worker.join();
+		}
+	}
+
+	ThreadPool& ThreadPool::shared() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+
+	void ThreadPool::workerLoop() {
+		while (true) {
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_taskAvailable.wait(lock, [this] { return m_stopping || m_nextTask < m_tasks.size(); });
+				if (m_nextTask == m_tasks.size()) return; // stopping
+				task = popTask();
+			}
+			task.run(task.context, task.index);
+		}
+	}
+
+	bool ThreadPool::runPendingTask() {
+		Task task;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_nextTask == m_tasks.size()) return false;
+			task = popTask();
+		}
+		task.run(task.context, task.index);
+		return true;
+	}
+
+	ThreadPool::Task ThreadPool::popTask() {
+		Task task = m_tasks[m_nextTask++];
+		// start from the front again once it's drained, or drop the finished half if it never is
+		if (m_nextTask == m_tasks.size()) {
+			m_tasks.clear();
+			m_nextTask = 0;
+		}
+		else if (m_nextTask > m_tasks.size() / 2) {
+			m_tasks.erase(m_tasks.begin(), m_tasks.begin() + std::ptrdiff_t(m_nextTask));
+			m_nextTask = 0;
+		}
+		return task;
+	}
+
+
+	void ThreadPool::runTiles(int begin, int end, int tileSize, void (*call)(const void* fn, int tileBegin, int tileEnd), const void* fn) {
+		if (end <= begin) return;
+		tileSize = std::max(1, tileSize);
+
+		int numTiles = (end - begin + tileSize - 1) / tileSize;
+		if (numTiles == 1 || m_workers.empty()) {
+			call(fn, begin, end);
+			return;
+		}
+
+		// completion state lives on this stack frame, we don't return until every tile is done
+		struct Tiles {
+			int begin, end, tileSize;
+			void (*call)(const void*, int, int);
+			const void* fn;
+			std::atomic<int> remaining;
+			std::mutex doneMutex;
+			std::condition_variable done;
+		} tiles{ begin, end, tileSize, call, fn, { numTiles }, {}, {} };
+
+		auto runTile = [](void* context, int tile) {
+			Tiles& tiles = *static_cast<Tiles*>(context);
+			int tileBegin = tiles.begin + tile * tiles.tileSize;
+			tiles.call(tiles.fn, tileBegin, std::min(tiles.end, tileBegin + tiles.tileSize));
+
+			// decrement under the lock so the waiter can't return (and destroy it) in between
+			std::lock_guard<std::mutex> lock(tiles.doneMutex);
+			if (--tiles.remaining == 0) {
+				tiles.done.notify_all();
+			}
+		};
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (int tile = 1; tile < numTiles; tile++) {
+				m_tasks.push_back(Task{ runTile, &tiles, tile });
+			}
+		}
+		m_taskAvailable.notify_all();
+
+		// do the first tile here, then help with whatever is still queued
+		runTile(&tiles, 0);
+		while (tiles.remaining > 0 && runPendingTask()) {}
+
+		std::unique_lock<std::mutex> lock(tiles.doneMutex);
+		tiles.done.wait(lock, [&] { return tiles.remaining == 0; });
+	}
+
+
+	void ThreadPool::enqueue(std::function<void()> fn) {
+		if (m_workers.empty()) {
+			fn();
+			return;
+		}
+
+		// the task owns a copy of fn and deletes it once it has run
+		auto runOwned = [](void* context, int) {
+			std::unique_ptr<std::function<void()>> owned(static_cast<std::function<void()>*>(context));
+			(*owned)();
+		};
+		auto owned = std::make_unique<std::function<void()>>(std::move(fn));
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push_back(Task{ runOwned, owned.get(), 0 });
+			owned.release();
+		}
+		m_taskAvailable.notify_one();
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace terrain {
+
+	// Fixed set of worker threads for splitting terrain work into tiles.
+	// parallelFor() blocks until every tile is finished, and the calling thread runs tiles
+	// too while it waits, so it is safe to call from inside another tile.
+	// parallelFor() doesn't allocate once the queue has grown to the most tiles in flight, so
+	// it can run every iteration of a simulation.
+	class ThreadPool {
+	public:
+		// numThreads == 0 uses one thread per hardware core (the caller counts as one of them)
+		explicit ThreadPool(unsigned numThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// number of height map rows each worker thread processes at a time in the row by row passes
+		// over a terrain (generating it, building its mesh)
+		static constexpr int rowsPerTile = 8;
+
+		// total threads that work on a parallelFor, including the caller
+		unsigned size() const { return unsigned(m_workers.size()) + 1; }
+
+		// Calls fn(tileBegin, tileEnd) for consecutive tiles of at most tileSize items covering
+		// [begin, end). Tiles may run in any order on any thread, so fn must only write to the
+		// items in its own tile; results are then the same for any number of threads.
+		// fn is called through a pointer to it instead of being copied into a std::function.
+		template <typename Fn>
+		void parallelFor(int begin, int end, int tileSize, const Fn& fn) {
+			runTiles(begin, end, tileSize, [](const void* f, int tileBegin, int tileEnd) {
+				(*static_cast<const Fn*>(f))(tileBegin, tileEnd);
+			}, std::addressof(fn));
+		}
+
+		// Queues fn to run on a worker thread and returns straight away. Queued tasks still run
+		// when the pool is destroyed. A pool without workers (one thread) runs fn before returning.
+		void enqueue(std::function<void()> fn);
+
+		// pool shared by the terrain code
+		static ThreadPool& shared();
+
+	private:
+		// a queued call of run(context, index), which doesn't own context
+		struct Task {
+			void (*run)(void* context, int index);
+			void* context;
+			int index;
+		};
+
+		std::vector<std::thread> m_workers;
+		std::vector<Task> m_tasks; // first in, first out from m_nextTask, keeps its capacity
+		std::size_t m_nextTask = 0;
+		std::mutex m_mutex;
+		std::condition_variable m_taskAvailable;
+		bool m_stopping = false;
+
+		void workerLoop();
+
+		// runs one queued task on this thread, returns false if the queue was empty
+		bool runPendingTask();
+
+		// takes the next task off the queue, m_mutex must be held and the queue not empty
+		Task popTask();
+
+		void runTiles(int begin, int end, int tileSize, void (*call)(const void* fn, int tileBegin, int tileEnd), const void* fn);
+	};
+}
@@ -0,0 +1,186 @@
+
+// std
+#include <algorithm>
+
+// project
+#include "tile_streamer.hpp"
+
+
+namespace terrain {
+
+	std::size_t TileData::bytes() const {
+		std::size_t padded = std::size_t(heightMap.stride()) * (heightMap.height() + 2 * heightMap.border());
+		return sizeof(TileData) + padded * sizeof(float)
+			+ normals.capacity() * sizeof(glm::vec3) + offsets.capacity() * sizeof(float);
+	}
+
+
+	TileData generateTile(const TileSettings& settings, const PermutationTable& perm, TileCoord coord, ThreadPool& pool) {
+		TileData tile;
+		tile.coord = coord;
+
+		GenerationParams params = settings.generation;
+		params.size = settings.tileSize + 1;
+		params.origin = glm::ivec2(coord.x, coord.y) * settings.tileSize;
+		tile.heightMap = generateHeightfield(params, perm, &tile.normals, pool);
+
+		//texture transition offsets are sampled at the global sample index, like the single mesh does
+		const int size = params.size;
+		tile.offsets.resize(std::size_t(size) * size);
+		Fbm offsetFbm(settings.offsetFractal, perm);
+		std::vector<float> xs(size), ys(size);
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				xs[x] = float(params.origin.x + x);
+				ys[x] = float(params.origin.y + y);
+			}
+			offsetFbm.evaluate(xs.data(), ys.data(), tile.offsets.data() + std::size_t(y) * size, size);
+		}
+
+		return tile;
+	}
+
+
+	TileStreamer::TileStreamer(unsigned numThreads)
+		: m_pool(numThreads ? std::max(numThreads, 2u) : std::max(2u, std::thread::hardware_concurrency() / 2)) { }
+
+	TileStreamer::~TileStreamer() {
+		// queued workers find nothing to do and return, the pool then joins them
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		m_pending.clear();
+	}
+
+
+	void TileStreamer::configure(const TileSettings& settings, std::shared_ptr<const PermutationTable> perm) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_settings = settings;
+		m_perm = std::move(perm);
+		m_generation++;
+
+		m_lru.clear();
+		m_cache.clear();
+		m_pending.clear();
+		m_used = 0;
+	}
+
+	void TileStreamer::setMemoryBudget(std::size_t bytes) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_budget = bytes;
+		evictOverBudget();
+	}
+
+	std::size_t TileStreamer::memoryBudget() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_budget;
+	}
+
+
+	void TileStreamer::update(const std::vector<TileCoord>& wanted) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_perm) return;
+
+		m_wanted.clear();
+		m_wanted.insert(wanted.begin(), wanted.end());
+
+		//touch the wanted tiles, least important first so the nearest end up most recently used
+		std::size_t wantedBytes = 0;
+		for (auto it = wanted.rbegin(); it != wanted.rend(); ++it) {
+			auto cached = m_cache.find(*it);
+			if (cached == m_cache.end()) continue;
+			m_lru.splice(m_lru.begin(), m_lru, cached->second);
+			wantedBytes += (*cached->second)->bytes();
+		}
+
+		//queue what's missing, but only as much as still fits in the budget
+		std::size_t estimate = tileBytesEstimate();
+		std::size_t room = m_budget > wantedBytes ? (m_budget - wantedBytes) / estimate : 0;
+		m_pending.clear();
+		for (const TileCoord& coord : wanted) {
+			if (m_pending.size() >= room) break;
+			if (m_cache.count(coord) || m_inFlight.count(coord)) continue;
+			m_pending.push_back(coord);
+		}
+
+		evictOverBudget();
+
+		//one task per worker thread (the pool counts the caller too), each keeps going while there is work
+		int workers = int(std::min<std::size_t>(m_pool.size() - 1, m_pending.size()));
+		for (; m_running < workers; m_running++) {
+			m_pool.enqueue([this] { workerLoop(); });
+		}
+	}
+
+
+	std::shared_ptr<const TileData> TileStreamer::find(TileCoord coord) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto cached = m_cache.find(coord);
+		return cached == m_cache.end() ? nullptr : *cached->second;
+	}
+
+	std::size_t TileStreamer::memoryUsed() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_used;
+	}
+
+	std::size_t TileStreamer::tileCount() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_cache.size();
+	}
+
+	std::size_t TileStreamer::tilesPending() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_pending.size() + m_inFlight.size();
+	}
+
+
+	void TileStreamer::workerLoop() {
+		//each tile is generated on this thread alone, the pool's parallelism is across tiles
+		ThreadPool serial(1);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_stopping && !m_pending.empty()) {
+			TileCoord coord = m_pending.front();
+			m_pending.erase(m_pending.begin());
+			m_inFlight.insert(coord);
+
+			TileSettings settings = m_settings;
+			std::shared_ptr<const PermutationTable> perm = m_perm;
+			std::uint64_t generation = m_generation;
+
+			lock.unlock();
+			auto tile = std::make_shared<const TileData>(generateTile(settings, *perm, coord, serial));
+			lock.lock();
+
+			m_inFlight.erase(coord);
+			if (generation != m_generation || m_cache.count(coord)) continue;
+
+			m_lru.push_front(tile);
+			m_cache[coord] = m_lru.begin();
+			m_used += tile->bytes();
+			evictOverBudget();
+		}
+		m_running--;
+	}
+
+
+	void TileStreamer::evictOverBudget() {
+		auto it = m_lru.end();
+		while (m_used > m_budget && it != m_lru.begin()) {
+			--it;
+			if (m_wanted.count((*it)->coord)) continue;
+
+			m_used -= (*it)->bytes();
+			m_cache.erase((*it)->coord);
+			it = m_lru.erase(it);
+		}
+	}
+
+
+	std::size_t TileStreamer::tileBytesEstimate() const {
+		std::size_t samples = std::size_t(m_settings.tileSize + 1) * (m_settings.tileSize + 1);
+		std::size_t paddedRow = (std::size_t(m_settings.tileSize + 3) + 15) & ~std::size_t(15);
+		return sizeof(TileData) + paddedRow * (m_settings.tileSize + 3) * sizeof(float)
+			+ samples * (sizeof(glm::vec3) + sizeof(float));
+	}
+}
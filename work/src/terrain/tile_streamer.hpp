@@ -0,0 +1,127 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "heightfield.hpp"
+#include "fbm.hpp"
+#include "generator.hpp"
+#include "thread_pool.hpp"
+
+namespace terrain {
+
+	// index of a tile in the infinite tile grid
+	struct TileCoord {
+		int x = 0;
+		int y = 0;
+
+		bool operator==(const TileCoord& other) const { return x == other.x && y == other.y; }
+		bool operator!=(const TileCoord& other) const { return !(*this == other); }
+	};
+
+	struct TileCoordHash {
+		std::size_t operator()(const TileCoord& c) const {
+			return std::hash<std::uint64_t>()((std::uint64_t(std::uint32_t(c.x)) << 32) | std::uint32_t(c.y));
+		}
+	};
+
+
+	// Everything that decides what a tile looks like, apart from the seed.
+	struct TileSettings {
+		GenerationParams generation;	// size and origin are set per tile
+		FractalParams offsetFractal;	// texture transition offsets
+		int tileSize = 64;				// quads along each side, tiles are tileSize + 1 samples across
+	};
+
+
+	// The generated data of one tile. Tile (tx, ty) covers the global samples
+	// [tx * tileSize, (tx + 1) * tileSize] along x (and likewise along y), so its edge samples are
+	// also the edge samples of its neighbours and come out identical in both.
+	struct TileData {
+		TileCoord coord;
+		Heightfield heightMap;			// (tileSize + 1)^2 with the generator's 1 sample border
+		std::vector<glm::vec3> normals;	// from the fbm gradient, row major
+		std::vector<float> offsets;		// texture transition offsets, row major
+
+		std::size_t bytes() const;
+	};
+
+
+	// Generates tiles on worker threads and keeps them in a least recently used cache that is
+	// held under a memory budget.
+	// Every frame the caller passes the tiles it wants (nearest first) to update(); tiles that
+	// aren't cached are queued for generation in that order, and a queued tile that stops being
+	// wanted is dropped before it is generated. Tiles wanted in the latest update are never evicted.
+	class TileStreamer {
+	public:
+		// numThreads == 0 uses half the hardware threads (at least 2, so there is always a worker)
+		explicit TileStreamer(unsigned numThreads = 0);
+		~TileStreamer();
+
+		TileStreamer(const TileStreamer&) = delete;
+		TileStreamer& operator=(const TileStreamer&) = delete;
+
+		// drops every cached tile, tiles still being generated with the old settings are discarded
+		void configure(const TileSettings& settings, std::shared_ptr<const PermutationTable> perm);
+
+		void setMemoryBudget(std::size_t bytes);
+		std::size_t memoryBudget() const;
+
+		// wanted is in priority order, most important first
+		void update(const std::vector<TileCoord>& wanted);
+
+		// cached tile, or null if it hasn't been generated (yet)
+		std::shared_ptr<const TileData> find(TileCoord coord) const;
+
+		std::size_t memoryUsed() const;
+		std::size_t tileCount() const;
+		std::size_t tilesPending() const;
+
+	private:
+		using Entry = std::shared_ptr<const TileData>;
+
+		TileSettings m_settings;
+		std::shared_ptr<const PermutationTable> m_perm;
+		std::uint64_t m_generation = 0; // bumped by configure() to discard results of old settings
+
+		std::list<Entry> m_lru; // most recently used first
+		std::unordered_map<TileCoord, std::list<Entry>::iterator, TileCoordHash> m_cache;
+		std::unordered_set<TileCoord, TileCoordHash> m_wanted;
+		std::unordered_set<TileCoord, TileCoordHash> m_inFlight;
+		std::vector<TileCoord> m_pending; // next tile to generate first
+
+		std::size_t m_budget = std::size_t(64) << 20;
+		std::size_t m_used = 0;
+		int m_running = 0;
+		bool m_stopping = false;
+		mutable std::mutex m_mutex;
+
+		// declared last so its workers are joined before the state above is destroyed
+		ThreadPool m_pool;
+
+		// generates pending tiles until there are none left
+		void workerLoop();
+
+		// evicts unwanted tiles, oldest first, until the cache fits in the budget. needs m_mutex
+		void evictOverBudget();
+
+		// approximate size of one tile with the current settings
+		std::size_t tileBytesEstimate() const;
+	};
+
+
+	// generates a single tile, used by TileStreamer and anything else that needs one tile
+	TileData generateTile(const TileSettings& settings, const PermutationTable& perm, TileCoord coord,
+		ThreadPool& pool = ThreadPool::shared());
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// std
+#include <atomic>
+
+namespace terrain {
+
+	// Hands the newest of a stream of values from one writer thread to one reader thread without
+	// locks or waiting. Of the 3 buffers the writer owns one (back), the reader owns one (front)
+	// and the third holds the newest finished value. publish() swaps the back buffer with the
+	// held one, update() swaps the held one with the front buffer if it is newer. Neither side
+	// ever touches the other's buffer, so the buffers keep their allocations and the reader
+	// only ever skips values, it never sees one half written.
+	template <typename T>
+	class TripleBuffer {
+	public:
+		TripleBuffer() = default;
+		TripleBuffer(const TripleBuffer&) = delete;
+		TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+		// writer only: the buffer to fill in, it may still hold an older value
+		T& back() { return m_buffers[m_back]; }
+
+		// writer only: makes the back buffer the newest value and gets another one to fill in
+		void publish() {
+			m_back = m_held.exchange(m_back | fresh, std::memory_order_acq_rel) & index;
+		}
+
+		// reader only: moves to the newest value, returns false if nothing was published since
+		bool update() {
+			if (!(m_held.load(std::memory_order_relaxed) & fresh)) return false;
+			m_front = m_held.exchange(m_front, std::memory_order_acq_rel) & index;
+			return true;
+		}
+
+		// reader only: the value update() last moved to
+		T& front() { return m_buffers[m_front]; }
+		const T& front() const { return m_buffers[m_front]; }
+
+	private:
+		static constexpr int index = 3;
+		static constexpr int fresh = 4; // set on the held index when it hasn't been read yet
+
+		T m_buffers[3];
+		int m_back = 0;
+		int m_front = 1;
+		std::atomic<int> m_held{ 2 };
+	};
+}
@@ -1,9 +1,13 @@
 
 // std
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <chrono>
 #include <algorithm>
+#include <atomic>
 #include <random>
 
 // glm
@@ -12,6 +16,8 @@
 
 // project
 #include "terrainRenderer.hpp"
+#include "terrain/thread_pool.hpp"
+#include "terrain/generator.hpp"
 #include "water/WaterRenderer.hpp"
 #include "cgra/cgra_geometry.hpp"
 #include "cgra/cgra_gui.hpp"
@@ -26,11 +32,14 @@ using namespace glm;
 
 
 void basic_terrain_model::draw(const glm::mat4& view, const glm::mat4 proj, const vec4 & clip_plane) {
-	mat4 modelview = view * modelTransform;
+	bind(proj, clip_plane);
+	drawMesh(mesh, view * modelTransform);
+}
+
 
+void basic_terrain_model::bind(const glm::mat4 proj, const vec4& clip_plane) {
 	glUseProgram(shader); // load shader and variables
 	glUniformMatrix4fv(glGetUniformLocation(shader, "uProjectionMatrix"), 1, false, value_ptr(proj));
-	glUniformMatrix4fv(glGetUniformLocation(shader, "uModelViewMatrix"), 1, false, value_ptr(modelview));
 	glUniform3fv(glGetUniformLocation(shader, "uColor"), 1, value_ptr(color));
 	glUniform4fv(glGetUniformLocation(shader, "uClipPlane"), 1, value_ptr(clip_plane));
 	glUniform1i(glGetUniformLocation(shader, "textureSampler0"), 3);
@@ -46,9 +55,60 @@ void basic_terrain_model::draw(const glm::mat4& view, const glm::mat4 proj, cons
 	glActiveTexture(GL_TEXTURE0 + 4);
 	glBindTexture(GL_TEXTURE_2D, grassTexture);
 
+	glUniform1i(glGetUniformLocation(shader, "uHeightMap"), 6);
+	glUniform1i(glGetUniformLocation(shader, "uWaterMap"), 7);
+	glActiveTexture(GL_TEXTURE0 + 6);
+	glBindTexture(GL_TEXTURE_2D, heightTexture);
+	glActiveTexture(GL_TEXTURE0 + 7);
+	glBindTexture(GL_TEXTURE_2D, waterTexture);
+}
+
+
+void basic_terrain_model::drawMesh(gl_mesh& mesh, const glm::mat4& modelview) {
+	glUniformMatrix4fv(glGetUniformLocation(shader, "uModelViewMatrix"), 1, false, value_ptr(modelview));
+	glUniform1i(glGetUniformLocation(shader, "uDisplace"), 0);
 	mesh.draw(); // draw
 }
 
+void basic_terrain_model::drawMesh(split_mesh& mesh, const glm::mat4& modelview) {
+	glUniformMatrix4fv(glGetUniformLocation(shader, "uModelViewMatrix"), 1, false, value_ptr(modelview));
+	glUniform1i(glGetUniformLocation(shader, "uDisplace"), displace);
+	mesh.draw();
+}
+
+
+void basic_terrain_model::uploadDisplacement(const Heightfield& heights, const Heightfield& water) {
+	ConstHeightfieldView paddedHeights = heights.paddedView();
+	ivec2 size(paddedHeights.width, paddedHeights.height);
+	bool allocate = size != displacementSize;
+	displacementSize = size;
+
+	//the rows go straight from the fields, skipping their alignment padding
+	auto upload = [&](cgra::gl_object& texture, const ConstHeightfieldView& field) {
+		if (!texture) {
+			texture = cgra::gl_object::gen_texture();
+			glBindTexture(GL_TEXTURE_2D, texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			allocate = true;
+		}
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, GLint(field.stride));
+		if (allocate) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, size.x, size.y, 0, GL_RED, GL_FLOAT, field.origin);
+			texture.set_bytes(size_t(size.x) * size.y * sizeof(float));
+		}
+		else {
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, GL_RED, GL_FLOAT, field.origin);
+		}
+	};
+	upload(heightTexture, paddedHeights);
+	upload(waterTexture, water.paddedView());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
 
 TerrainRenderer::TerrainRenderer() {
 
@@ -57,6 +117,8 @@ TerrainRenderer::TerrainRenderer() {
 	sb.set_shader(GL_FRAGMENT_SHADER, CGRA_SRCDIR + std::string("//res//shaders//terrain//color_frag.glsl"));
 	GLuint shader = sb.build();
 
+	setSeed(seed);
+
 	m_model.shader = shader;
 	m_model.color = vec3(0, 1, 0);
 
@@ -64,64 +126,44 @@ TerrainRenderer::TerrainRenderer() {
 	generateTerrain(numOctaves);
 	m_model.scale = scale;
 
-	waterVolume = vector<vector<float>>(m_model.heightMap.size(), vector<float>(m_model.heightMap[0].size(), 0));
-	sedimentVolume = vector<vector<float>>(m_model.heightMap.size(), vector<float>(m_model.heightMap[0].size(), 0));
-	
-
 	//bind texture
 
-	unsigned int sandTexture;
-	glGenTextures(1, &sandTexture);
+	m_model.sandTexture = cgra::gl_object::gen_texture();
 	glActiveTexture(GL_TEXTURE0 + 3);
-	glBindTexture(GL_TEXTURE_2D, sandTexture);
+	glBindTexture(GL_TEXTURE_2D, m_model.sandTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	textureImageSand = cgra::rgba_image(CGRA_SRCDIR + std::string("//res//textures//sand_texture.png"));
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureImageSand.size.x, textureImageSand.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureImageSand.data.data());
+	m_model.sandTexture.set_bytes(textureImageSand.data.size());
 
-	m_model.sandTexture = sandTexture;
 
 
-
-	unsigned int grassTexture;
-	glGenTextures(1, &grassTexture);
+	m_model.grassTexture = cgra::gl_object::gen_texture();
 	glActiveTexture(GL_TEXTURE0 + 4);
-	glBindTexture(GL_TEXTURE_2D, grassTexture);
+	glBindTexture(GL_TEXTURE_2D, m_model.grassTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	textureImageGrass = cgra::rgba_image(CGRA_SRCDIR + std::string("//res//textures//grass_texture.png"));
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureImageGrass.size.x, textureImageGrass.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureImageGrass.data.data());
+	m_model.grassTexture.set_bytes(textureImageGrass.data.size());
 
-	m_model.grassTexture = grassTexture;
 
 
-
-	unsigned int stoneTexture;
-	glGenTextures(1, &stoneTexture);
+	m_model.stoneTexture = cgra::gl_object::gen_texture();
 	glActiveTexture(GL_TEXTURE0 + 5);
-	glBindTexture(GL_TEXTURE_2D, stoneTexture);
+	glBindTexture(GL_TEXTURE_2D, m_model.stoneTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	textureImageStone = cgra::rgba_image(CGRA_SRCDIR + std::string("//res//textures//stone_texture.png"));
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureImageStone.size.x, textureImageStone.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureImageStone.data.data());
-
-	m_model.stoneTexture = stoneTexture;
-	
-
-	/*
-	//for test
-	testHM = vector<vector<float>>(5, vector<float>(5, 10));
-	testHM[2][2] = 5;
-
-	waterVolume = vector<vector<float>>(5, vector<float>(5, 0));
-	sedimentVolume = vector<vector<float>>(5, vector<float>(5, 0));
-	*/
+	m_model.stoneTexture.set_bytes(textureImageStone.data.size());
 }
 
 
@@ -133,116 +175,127 @@ TerrainRenderer::TerrainRenderer() {
 
 void TerrainRenderer::render(const glm::mat4& view, const glm::mat4& proj, const vec4& clip_plane) {
 
-	if (shouldErodeTerrain && currentErodeIteration < totalIterations) {
-
-		if (terrainType == 0) {
-			m_model.heightMap = erodeTerrainTerraces(m_model.heightMap, m_model.heightMap.size());
-		}else {
-			//testHM = erodeTerrainRealistic(testHM, 5, 1, erodeIter < rainIter);
-			m_model.heightMap = erodeTerrainRealistic(m_model.heightMap, m_model.heightMap.size());
-		}
-		currentErodeIteration++;
-
-		
-		//generate mesh
-		mesh_builder plane_mb = generatePlane();
+	//swap in a terrain the background job finished. Only in the main pass, so the water's
+	//passes later in the frame draw the same terrain
+	GeneratedTerrain generated;
+	if (clip_plane == vec4(0) && regenerateJob.poll(generated)) {
+		swapInTerrain(std::move(generated));
+	}
 
-		for (int y = 1; y < m_model.heightMap.size() - 1; y++) {
-			for (int x = 1; x < m_model.heightMap.size() - 1; x++) {
-				int i = (y - 1) * mapSize + (x - 1);
+	if (chunked) {
+		renderChunks(view, proj, clip_plane);
+		return;
+	}
 
-				plane_mb.vertices[i].pos.y = m_model.heightMap[y][x];
+	//show the newest erosion snapshot. Only in the main pass too, for the same reason
+	if (clip_plane == vec4(0) && erosionSimulation.poll()) {
+		showErosion(erosionSimulation.latest());
+	}
 
-				plane_mb.vertices[i].waterVolume = waterVolume[y][x];
 
-				//calc normal
-				float normX = m_model.heightMap[y][x - 1] / scale - m_model.heightMap[y][x + 1] / scale; //difference in height of previous vertex and next vertex along the x axis
-				float normZ = m_model.heightMap[y - 1][x] / scale - m_model.heightMap[y + 1][x] / scale; //difference in height of previous vertex and next vertex along the z axis	
-				plane_mb.vertices[i].norm = normalize(vec3(normX, 2, normZ));
-			}
-		}
-
-		
-		//generate texture transition offsets
-		for (int y = 0; y <= worldSize / squareSize; y++) {
-			for (int x = 0; x <= worldSize / squareSize; x++) {
-				int i = y * (worldSize / squareSize + 1) + x;
-				plane_mb.vertices[i].offset = homogeneousfbm(x * 1, y * 1, 5);
-			}
-		}
+	// draw the model
+	m_model.scale = scale;
+	m_model.draw(view, proj, clip_plane);
+}
 
-		m_model.mesh = plane_mb.build();
 
+void TerrainRenderer::renderChunks(const glm::mat4& view, const glm::mat4& proj, const vec4& clip_plane) {
+	mat4 chunkTransform = m_model.modelTransform * translate(mat4(1), vec3(-chunkCentre.x, 0, -chunkCentre.y));
 
-		if (currentErodeIteration % 5 == 0 ) { //every 10th iteration
-			// This tells the water renderer that it needs to update the 
-			// reflection and refraction textures
+	//only the main camera moves the streaming, the water's reflection and refraction passes
+	//(the ones with a clip plane) draw whatever is already loaded
+	if (clip_plane == vec4(0)) {
+		vec3 cameraPos = vec3(inverse(chunkTransform) * inverse(view) * vec4(0, 0, 0, 1));
+		if (m_chunks.update(cameraPos)) {
 			WaterRenderer::setSceneUpdated();
 		}
-
-		if (currentErodeIteration == totalIterations - 1) {
-			waterVolume = vector<vector<float>>(m_model.heightMap.size(), vector<float>(m_model.heightMap[0].size(), 0));
-			sedimentVolume = vector<vector<float>>(m_model.heightMap.size(), vector<float>(m_model.heightMap[0].size(), 0));
-		}
-		
 	}
-	
 
-	// draw the model
 	m_model.scale = scale;
-	m_model.draw(view, proj, clip_plane);
+	m_model.bind(proj, clip_plane);
+	mat4 modelview = view * chunkTransform;
+	m_chunks.draw([&](gl_mesh& mesh) {
+		m_model.drawMesh(mesh, modelview);
+	});
 }
 
 
 void TerrainRenderer::renderGUI() {
 
+	ImGui::Checkbox("Disk Cache", &useCache);
+
 	//generated a new seed and terrain
 	if (ImGui::Button("New Seed")) {
-		shouldErodeTerrain = false;
-		genPermutations();
-		generateTerrain(numOctaves);
+		stopErosion();
+		setSeed(seedGenerator());
+		requestTerrain();
         
 	}
 
+	if (regenerateJob.busy()) {
+		ImGui::SameLine();
+		ImGui::Text("generating...");
+	}
+
+	//type in a seed to go back to a terrain
+	if (ImGui::InputText("Seed", seedText, sizeof(seedText), ImGuiInputTextFlags_CharsDecimal | ImGuiInputTextFlags_EnterReturnsTrue)) {
+		stopErosion();
+		setSeed(std::strtoull(seedText, nullptr, 10));
+		requestTerrain();
+	}
+
 	//Base Terrain Options
 	if (ImGui::CollapsingHeader("Base Terrain")) {
 		ImGui::Indent();
 
+		if (ImGui::Checkbox("Octave Cache", &useOctaveCache) && !useOctaveCache) {
+			octaveLayers->clear();
+		}
+		ImGui::Checkbox("Progressive Preview", &progressivePreview);
+		if (progressivePreview) {
+			ImGui::Combo("Preview Resolution", &previewOption, "1/4\0" "1/8\0", 2);
+		}
+
 		//chose terrain type
 		if (ImGui::Combo("Terrain Type", &fractalType, "Normal Terrain\0Smooth Valleys\0Hybrid Multifractal\0", 3)) {
-			shouldErodeTerrain = false;
-			generateTerrain(numOctaves);
+			stopErosion();
+			requestTerrain();
+		}
+
+		if (ImGui::Combo("Noise", &noiseBasis, "Perlin\0Integer Hash\0Simplex\0", 3)) {
+			stopErosion();
+			requestTerrain();
 		}
 
 		//terrain options 
 		if (ImGui::SliderFloat("Scale", &scale, 1, 100, "%.0f", 1.0f)) {
-			generateTerrain(numOctaves);
+			requestTerrain();
 		}
 
 		if (ImGui::SliderFloat("Base Frequency", &baseFrequency, 0, 0.2, "%.3f")) {
-			generateTerrain(numOctaves);
+			requestTerrain();
 		}
 
 		if (ImGui::SliderFloat("Frequency Multiplier", &frequencyMultiplier, 1, 5, "%.1f")) {
-			generateTerrain(numOctaves);
+			requestTerrain();
 		}
 
 		if (ImGui::SliderFloat("Amptitude Multiplier", &amtitudeMultiplier, 0, 1, "%.2f")) {
-			generateTerrain(numOctaves);
+			requestTerrain();
 		}
 
 		if (ImGui::SliderInt("Num Octaves", &numOctaves, 0, 10)) {
-			generateTerrain(numOctaves);
+			requestTerrain();
 		}
 
 		//extra options for hybrid multifractal terrain type
 		if (fractalType == 2) {
 			if (ImGui::SliderFloat("Offset", &offset, -1, 1, "%.2f")) {
-				generateTerrain(numOctaves);
+				requestTerrain();
 			}
 
 			if (ImGui::SliderFloat("H", &H, 0, 1, "%.2f")) {
-				generateTerrain(numOctaves);
+				requestTerrain();
 			}
 		}
 
@@ -251,6 +304,38 @@ void TerrainRenderer::renderGUI() {
 	}
 
 
+	//Streaming Options
+	if (ImGui::CollapsingHeader("Streaming")) {
+		ImGui::Indent();
+
+		if (ImGui::Checkbox("Chunked Terrain", &chunked)) {
+			stopErosion();
+			generateTerrain(numOctaves);
+		}
+
+		if (chunked) {
+			ImGui::DragFloat2("Centre", value_ptr(chunkCentre), 5.0f);
+			ImGui::SliderFloat("View Distance", &m_chunks.viewDistance, 50, 1000, "%.0f");
+
+			if (ImGui::Combo("Tile Size", &tileSizeOption, "32\0" "64\0" "128\0", 3)) {
+				configureChunks();
+			}
+			if (ImGui::SliderInt("CPU Budget (MB)", &cpuBudgetMB, 16, 1024)) {
+				m_chunks.setCpuBudget(size_t(cpuBudgetMB) << 20);
+			}
+			if (ImGui::SliderInt("GPU Budget (MB)", &gpuBudgetMB, 16, 2048)) {
+				m_chunks.gpuBudget = size_t(gpuBudgetMB) << 20;
+			}
+
+			ImGui::Text("tiles: %d in view, %d uploaded, %d cached, %d pending", int(m_chunks.tilesInView()),
+				int(m_chunks.tilesUploaded()), int(m_chunks.tilesGenerated()), int(m_chunks.tilesPending()));
+			ImGui::Text("memory: %.1f MB CPU, %.1f MB GPU", m_chunks.cpuMemoryUsed() / 1048576.0, m_chunks.gpuMemoryUsed() / 1048576.0);
+		}
+
+		ImGui::Unindent();
+	}
+
+
 	//Texture Options
 	if (ImGui::CollapsingHeader("Texture")) {
 		ImGui::Indent();
@@ -267,18 +352,36 @@ void TerrainRenderer::renderGUI() {
 	if (ImGui::CollapsingHeader("Erosion")) {
 		ImGui::Indent();
 
+		//starts (or stops) eroding a freshly generated terrain, see swapInTerrain
 		if (ImGui::Button("Erode Terrain")) {
 			shouldErodeTerrain = !shouldErodeTerrain;
 			generateTerrain(numOctaves);
-			currentErodeIteration = 0;
 		}
 
 		ImGui::SameLine();
 
 		ImGui::Text("iter = %d", currentErodeIteration);
 
+		//the erosion runs on its own thread, it can be held or stopped where it is
+		if (erosionSimulation.running()) {
+			if (ImGui::Button(erosionSimulation.paused() ? "Resume" : "Pause")) {
+				erosionSimulation.pause(!erosionSimulation.paused());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Cancel")) {
+				stopErosion();
+			}
+			ImGui::SameLine();
+			ImGui::ProgressBar(float(erosionSimulation.progress()) / std::max(1, erosionSimulation.iterations()));
+		}
+
 		ImGui::Combo("Erosion Type", &terrainType, "Terraces\0Realistic\0", 2);
 
+		//each erosion step uploads two textures instead of rebuilding the mesh
+		if (ImGui::Checkbox("GPU Displacement", &gpuDisplacement) && !chunked) {
+			updateSurface();
+		}
+
 		ImGui::Separator();
 		ImGui::Text("Iterations:");
 		ImGui::InputFloat("Num iterations", &totalIterations);
@@ -287,17 +390,24 @@ void TerrainRenderer::renderGUI() {
 		ImGui::Separator();
 		ImGui::Text("Thermal Erosion:");
 		if (ImGui::SliderFloat("Talus Threshold", &talusThreshold, 0, 2, "%.2f")) {
-			generateTerrain(numOctaves);
+			requestTerrain();
 		}
 		ImGui::InputFloat("Erosion sediment volume", &sedimentvolume);
+		ImGui::Combo("Update", &thermalUpdate, "In Place\0Jacobi (threaded)\0Coloured (threaded)\0", 3);
+		ImGui::Combo("Traversal", &traversal, "Columns (original)\0Tiled\0", 2);
 
 
 		ImGui::Separator();
 		ImGui::Text("Hydrolic Erosion:");
+		ImGui::Combo("Model", &hydraulicModel, "Cells\0Pipes (shallow water)\0Droplets\0", 3);
 		ImGui::InputFloat("rain", &kr);
 		ImGui::InputFloat("desolve", &ks);
 		ImGui::InputFloat("Evaporation", &ke);
 		ImGui::InputFloat("Capacity", &kc);
+		if (hydraulicModel == 2) {
+			ImGui::SliderFloat("Droplets per cell", &dropletsPerCell, 0.01f, 2, "%.2f");
+			ImGui::SliderInt("Droplet lifetime", &dropletLifetime, 1, 100);
+		}
 
 		ImGui::Unindent();
 	}
@@ -311,78 +421,11 @@ void TerrainRenderer::renderGUI() {
 //--------------------------------------------------------------------------------
 
 
-float TerrainRenderer::perlinNoise(float x, float y) {
-
-	//get square corner and point in square coords	
-	int X = (int)fmod(x, 256); //square coords
-	int Y = (int)fmod(y, 256);
-	float xf = fmod(x, 1.0f); //point in square coords
-	float yf = fmod(y, 1.0f);
-
-	//get hash for each corner
-	int TR = permutations[(permutations[(X + 1) % 256] + Y + 1) % 256]; //top right
-	int TL = permutations[(permutations[X       % 256] + Y + 1) % 256]; //top left
-	int BR = permutations[(permutations[(X + 1) % 256] + Y)     % 256]; //bottom right
-	int BL = permutations[(permutations[X       % 256] + Y)     % 256]; //bottom left
-
-	//get const vector for each corner 
-	vec2 TR_ConstVec = getCornerVector(TR);
-	vec2 TL_ConstVec = getCornerVector(TL);
-	vec2 BR_ConstVec = getCornerVector(BR);
-	vec2 BL_ConstVec = getCornerVector(BL);
-
-	//get vertor to point for each corner
-	vec2 TR_VectorToPoint = vec2(xf - 1.0f, yf - 1.0f);
-	vec2 TL_VectorToPoint = vec2(xf,        yf - 1.0f);
-	vec2 BR_VectorToPoint = vec2(xf - 1.0f, yf);
-	vec2 BL_VectorToPoint = vec2(xf,		yf);
-
-	//get dot product for each corner
-	float TR_Val = dot(TR_ConstVec, TR_VectorToPoint);
-	float TL_Val = dot(TL_ConstVec, TL_VectorToPoint);
-	float BR_Val = dot(BR_ConstVec, BR_VectorToPoint);
-	float BL_Val = dot(BL_ConstVec, BL_VectorToPoint);
-
-	//get fade func of point in square
-	float u = fade(xf);
-	float v = fade(yf);
-
-	//interp to get result
-	float interpTop = lerp(u, TL_Val, TR_Val);
-	float interpBottom = lerp(u, BL_Val, BR_Val);
-	float result = lerp(v, interpBottom, interpTop); //between -1 and 1
-
-	return result;
-}
-
-//Gets the constant vector at a corner given its hash from the permutations table which can then be used to get the
-//dot product with the vector towards the point in the square. Does this by returning a different vector based on the
-//first 4 bits of the hash of the conter.
-//probably not as efficient as Perlin's grad() function but much easier to understand than a bunch of bit flipping.
-vec2 TerrainRenderer::getCornerVector(int corner) {
-	int hash = corner % 4;
-	switch (hash) {
-	case 0: return vec2(1.0f, 1.0f); break;
-	case 1: return vec2(-1.0f, 1.0f); break;
-	case 2: return vec2(-1.0f, -1.0f); break;
-	case 3: return vec2(1.0f, -1.0f); break;
-	default: return vec2(1); break; //should never happen
-	}
-}
-
-float TerrainRenderer::fade(float t) {
-	return t * t * t * (t * (t * 6 - 15) + 10);
-}
-
-float TerrainRenderer::lerp(float x, float p1, float p2) {
-	//assert(x >= 0 && x <= 1);
-
-	return p1 + x * (p2 - p1);
-}
-
-void TerrainRenderer::genPermutations() {
-	//shuffle the seed (permutation table)
-	std::shuffle(permutations, permutations + 256, default_random_engine());
+void TerrainRenderer::setSeed(std::uint64_t newSeed) {
+	//tables for seeds we've used recently are still cached
+	seed = newSeed;
+	permutationTable = PermutationCache::shared().get(seed);
+	snprintf(seedText, sizeof(seedText), "%llu", (unsigned long long)seed);
 }
 
 
@@ -393,335 +436,316 @@ void TerrainRenderer::genPermutations() {
 
 
 void TerrainRenderer::generateTerrain(int numOctaves) {
-	
-	//generate height map
-	//generate extra points along all sides for calculating the normals at the edges
-	vector<vector<float>> heightMap(mapSize + 2, vector<float>(mapSize + 2, 0));
-	//float stepSize = size / numTrianglesAcross;
-	for (int y = 0; y < mapSize + 2; y++) {
-		for (int x = 0; x < mapSize + 2; x++) {
-			if (fractalType == 0) {
-				heightMap[y][x] = homogeneousfbm(x * squareSize, y * squareSize, numOctaves) * scale;
-			}
-			else if (fractalType == 1) {
-				heightMap[y][x] = (heterogeneousfbm(x * squareSize, y * squareSize, numOctaves) - 0.5f) * scale;
-			}
-			else {
-				heightMap[y][x] = (hybridMultifractal(x * squareSize, y * squareSize, numOctaves) - 0.5f) * scale;
-			}
-		}
-	}
-	m_model.heightMap = heightMap;
-	
 
-	waterVolume = vector<vector<float>>(heightMap.size(), vector<float>(heightMap[0].size(), 0));
-	sedimentVolume = vector<vector<float>>(heightMap.size(), vector<float>(heightMap[0].size(), 0));
+	//the streamed tiles are generated on demand instead
+	if (chunked) {
+		configureChunks();
+		return;
+	}
 
-	
-	//generate mesh
-	mesh_builder plane_mb = generatePlane();
+	//this replaces anything the background job was working on
+	regenerateJob.cancel();
 
-	for (int y = 1; y < heightMap.size()-1; y++) {
-		for (int x = 1; x < heightMap[0].size()-1; x++) {
-			int i = (y-1) * mapSize + (x-1);
+	GeneratedTerrain terrain;
+	std::atomic<bool> cancelled{ false };
+	makeTerrain(terrainRequest(numOctaves), 1, terrain, cancelled);
+	swapInTerrain(std::move(terrain));
+}
 
-			plane_mb.vertices[i].pos.y = heightMap[y][x];
 
-			//calc normal
-			float normX = heightMap[y][x-1]/scale - heightMap[y][x + 1] / scale; //difference in height of previous vertex and next vertex along the x axis
-			float normZ = heightMap[y-1][x] / scale - heightMap[y+1][x] / scale; //difference in height of previous vertex and next vertex along the z axis	
-			plane_mb.vertices[i].norm = normalize(vec3(normX, 2, normZ));
-		}
+//regenerates the terrain on the background job, the current terrain keeps rendering until
+//render() swaps in the new one. Quick successive requests (dragging a slider) coalesce.
+//With the progressive preview a tiny low resolution terrain is shown straight away instead,
+//and the job refines it at double the resolution each stage
+void TerrainRenderer::requestTerrain() {
+	if (chunked) {
+		configureChunks();
+		return;
 	}
-	
 
-	//generate texture transition offsets
-	for (int y = 0; y < mapSize; y++) {
-		for (int x = 0; x < mapSize; x++) {
-			int i = y*mapSize + x;
-			plane_mb.vertices[i].offset = homogeneousfbm(x * 1, y * 1, 5);
-		}
-	}
-
-	m_model.mesh = plane_mb.build();
+	TerrainRequest request = terrainRequest(numOctaves);
+	int previewStride = progressivePreview ? (previewOption == 0 ? 4 : 8) : 1;
 
+	if (previewStride > 1) {
+		GeneratedTerrain preview;
+		std::atomic<bool> cancelled{ false };
+		makeTerrain(request, previewStride, preview, cancelled);
+		swapInTerrain(std::move(preview));
+	}
 
-	// This tells the water renderer that it needs to update the 
-	// reflection and refraction textures
-	WaterRenderer::setSceneUpdated();
+	regenerateJob.post([this, request, previewStride](GeneratedTerrain& terrain, const std::atomic<bool>& cancelled) {
+		for (int stride = previewStride / 2; stride > 1; stride /= 2) {
+			GeneratedTerrain stage;
+			if (!makeTerrain(request, stride, stage, cancelled)) return false;
+			regenerateJob.publish(std::move(stage));
+		}
+		return makeTerrain(request, 1, terrain, cancelled);
+	});
 }
 
 
-mesh_builder TerrainRenderer::generatePlane() {
-
-	std::vector<vec3> vertices;
-	std::vector<vec2> positions;
-	std::vector<int> indices;
-
-	//float stepSize = size / numTrianglesAcross;
+//everything makeTerrain needs, copied so the job never reads members the GUI is changing
+TerrainRenderer::TerrainRequest TerrainRenderer::terrainRequest(int numOctaves) const {
+	TerrainRequest request;
+	request.params.fractal = fractalParams(numOctaves);
+	request.params.scale = scale;
+	request.params.size = mapSize;
+	request.params.squareSize = squareSize;
+	request.offsetParams = offsetParams();
+	request.seed = seed;
+	request.perm = permutationTable;
+	request.cache = useCache ? heightmapCache : HeightmapCache();
+	if (useOctaveCache) request.layers = octaveLayers;
+	return request;
+}
 
-	for (int y = 0; y < mapSize; y++) {
-		for (int x = 0; x < mapSize; x++) {
-			//make vertex
-			vertices.push_back(vec3(x* squareSize, 0, y* squareSize));
-			positions.push_back(vec2(x,y));
 
-			//make triangles (populate index buffer)
-			if (x < mapSize-1 && y < mapSize-1) {
-				int currentIndex = y * mapSize + x;
+//generates (or loads) a height map from every stride-th sample and fills in its mesh,
+//returns false if it was cancelled
+bool TerrainRenderer::makeTerrain(const TerrainRequest& request, int stride, GeneratedTerrain& terrain, const std::atomic<bool>& cancelled) {
+	GenerationParams params = request.params;
+	params.size = (params.size - 1) / stride + 1;
+	params.stride = stride;
 
-				indices.push_back(currentIndex);
-				indices.push_back(currentIndex + 1);
-				indices.push_back(currentIndex + mapSize);
+	//previews are quick to make again, only full resolution terrains are worth caching
+	const HeightmapCache cache = stride == 1 ? request.cache : HeightmapCache();
 
-				indices.push_back(currentIndex + 1);
-				indices.push_back(currentIndex + mapSize + 1);
-				indices.push_back(currentIndex + mapSize);
-			}
+	//generate height map (and the normals from the fbm gradient)
+	terrain.key = generationKey(request.seed, params);
+	terrain.stride = stride;
+	if (!cache.load(terrain.key, terrain.heightMap, nullptr, &terrain.normals)) {
+		//the octave layers are kept for the full resolution grid, previews would only replace them
+		if (request.layers && stride == 1) {
+			terrain.heightMap = request.layers->generate(params, *request.perm, &terrain.normals, ThreadPool::shared(), &cancelled);
 		}
+		else {
+			terrain.heightMap = generateHeightfield(params, *request.perm, &terrain.normals, ThreadPool::shared(), &cancelled);
+		}
+		if (cancelled) return false;
+		cache.store(terrain.key, terrain.heightMap, nullptr, &terrain.normals);
 	}
 
-	//make mesh
-	mesh_builder mb;
-
-	for (int i = 0; i < vertices.size(); i++) {
-		mb.push_vertex(mesh_vertex{
-						vertices[i], //point coordinates
-						vec3(0,1,0), //normal
-						positions[i],
-						0.0f}); //uv
-	}
-
-	for (int i = 0; i < indices.size(); i++) {
-		mb.push_index(indices[i]);
-	}
-
-	return mb;
+	int size = terrain.heightMap.width();
+	Heightfield noWater(size, size, 1);
+	Fbm offsetFbm(request.offsetParams, *request.perm);
+	buildGrid(size, params.squareSize * stride, stride, offsetFbm, terrain.grid);
+	buildSurface(terrain.heightMap, noWater, terrain.normals, params.scale, terrain.surface);
+	return !cancelled;
 }
 
 
+//replaces the current terrain (and its mesh) with a newly generated one
+void TerrainRenderer::swapInTerrain(GeneratedTerrain&& terrain) {
+	terrainKey = terrain.key;
+	terrainStride = terrain.stride;
+	m_model.heightMap = std::move(terrain.heightMap);
+	terrainNormals = std::move(terrain.normals);
 
-vector<vector<float>> TerrainRenderer::erodeTerrainTerraces(vector<vector<float>> heightMap, int size) {
-
-	for (int x = 1; x < size - 1; x++) {
-		for (int y = 1; y < size - 1; y++) {
-
-			//get neightbor with steapest slope
-			float dmax = 0;
-			vec2 neigh = vec2(0, 0);
-			for (int i = -1; i <= 1; i++) {
-				for (int j = -1; j <= 1; j++) {
+	int size = m_model.heightMap.width();
+	waterVolume = Heightfield(size, size, 1);
 
-					float d = heightMap[y][x] - heightMap[y + j][x + i];
-					if (d > dmax) {
-						dmax = d;
-						neigh = vec2(x + i, y + j);
-					}
+	m_model.mesh.set_grid(terrain.grid, m_model.heightMap.width());
+	m_model.mesh.set_surface(terrain.surface);
+	if (gpuDisplacement) updateSurface();
 
-				}
-			}
+	//an erosion starts again on the new terrain once it is at full resolution
+	currentErodeIteration = 0;
+	if (shouldErodeTerrain && terrainStride == 1) {
+		startErosion();
+	}
+	else {
+		erosionSimulation.cancel();
+	}
 
-			//erode point (move material down the slope)
-			if (dmax > 0 && dmax <= talusThreshold) {
-				vec2 b = vec2(heightMap[y][x], heightMap[neigh.y][neigh.x]);
 
-				float deltaH = 0.3 * dmax;
-				heightMap[y][x] -= deltaH;
-				heightMap[neigh.y][neigh.x] += deltaH;
+	// This tells the water renderer that it needs to update the 
+	// reflection and refraction textures
+	WaterRenderer::setSceneUpdated();
+}
 
-			}
 
-		}
+//re-uploads the heights, normals and water volume after the height map changed, the grid stays.
+//With GPU displacement that is just the height map and water volume textures
+void TerrainRenderer::updateSurface() {
+	m_model.displace = gpuDisplacement;
+	if (gpuDisplacement) {
+		m_model.uploadDisplacement(m_model.heightMap, waterVolume);
+		return;
 	}
-
-
-	return heightMap;
+	buildSurface(m_model.heightMap, waterVolume, terrainNormals, scale, surfaceVertices);
+	m_model.mesh.set_surface(surfaceVertices);
 }
 
 
-vector<vector<float>> TerrainRenderer::erodeTerrainRealistic(vector<vector<float>> heightMap, int size) {
-
-	for (int x = 1; x < size - 1; x++) {
-		for (int y = 1; y < size - 1; y++) {
-			
-			//Thermal Erosion
-			if (currentErodeIteration % 1 == 0) {
-
-				float totalDiff = 0;
-				float diffMax = 0;
-				for (int i = -1; i <= 1; i++) {
-					for (int j = -1; j <= 1; j++) {
-						float diff = heightMap[y][x] - heightMap[y + j][x + i];
-						if (diff > diffMax) {
-							diffMax = diff;
-						}
-						if(diff > talusThreshold)
-							totalDiff += diff;
-					}
-				}
-				if (totalDiff > 0) {
-					float initialHeight = heightMap[y][x];
-					for (int i = -1; i <= 1; i++) {
-						for (int j = -1; j <= 1; j++) {
-							float diff = initialHeight - heightMap[y + j][x + i];
-							if (diff > talusThreshold) {
-								float moveAmount = sedimentvolume*(diffMax - talusThreshold)*(diff/totalDiff);
-								heightMap[y][x] -= moveAmount;
-								heightMap[y + j][x + i] += moveAmount;
-							}
-						}
-					}
-				}
+//fills in the static part of a terrain mesh: a size x size grid of vertices spacing apart,
+//with the texture transition offsets of every stride-th sample. Doesn't touch OpenGL, so it can
+//run on any thread
+void TerrainRenderer::buildGrid(int size, float spacing, int stride, const Fbm& offsetFbm,
+	vector<static_vertex>& vertices) {
 
+	vertices.resize(size_t(size) * size);
+	ThreadPool::shared().parallelFor(0, size, ThreadPool::rowsPerTile, [&](int yBegin, int yEnd) {
+		vector<float> xs(size), ys(size), offsets(size);
+		for (int y = yBegin; y < yEnd; y++) {
+			for (int x = 0; x < size; x++) {
+				xs[x] = float(x * stride);
+				ys[x] = float(y * stride);
 			}
-			
+			offsetFbm.evaluate(xs.data(), ys.data(), offsets.data(), size);
 
+			for (int x = 0; x < size; x++) {
+				static_vertex& v = vertices[size_t(y) * size + x];
+				v.pos = vec3(x * spacing, 0, y * spacing);
+				v.uv = vec2(x, y);
+				v.offset = offsets[x];
+			}
+		}
+	});
+}
 
 
-			
-			//Hydrolic Erosion
+//fills in the dynamic part of a terrain mesh from the height map and water volume.
+//uses the generated normals when there are any, otherwise differences the height map
+void TerrainRenderer::buildSurface(const Heightfield& heightMap, const Heightfield& waterVolume,
+	const vector<vec3>& normals, float scale, vector<dynamic_vertex>& vertices) {
 
-			//add water (rain)
-			waterVolume[y][x] += kr;
-			
+	vertices.resize(size_t(heightMap.width()) * heightMap.height());
 
+	//each vertex is written by exactly one row tile
+	ThreadPool::shared().parallelFor(0, heightMap.height(), ThreadPool::rowsPerTile, [&](int yBegin, int yEnd) {
+		for (int y = yBegin; y < yEnd; y++) {
+			const float* prevRow = heightMap.row(y - 1);
+			const float* row = heightMap.row(y);
+			const float* nextRow = heightMap.row(y + 1);
+			const float* waterRow = waterVolume.row(y);
 
-			//erode terrain (disolve sediment into water)
-			float erodeAmount = waterVolume[y][x] * ks;
-			heightMap[y][x] -= erodeAmount;
-			sedimentVolume[y][x] += erodeAmount;
+			for (int x = 0; x < heightMap.width(); x++) {
+				int i = y * heightMap.width() + x;
+				dynamic_vertex& v = vertices[i];
 
+				v.height = row[x];
+				v.waterVolume = waterRow[x];
 
-			//transport water with sediment in it
-			
-			float totalDiff = 0;
-			for (int i = -1; i <= 1; i++) {
-				for (int j = -1; j <= 1; j++) {
-					float diff = fmax(0.0f, (heightMap[y][x] + waterVolume[y][x]) - (heightMap[y + j][x + i] + waterVolume[y + j][x + i]));
-					totalDiff += diff;
+				//calc normal
+				if (!normals.empty()) {
+					v.norm = pack_normal(normals[i]);
 				}
-			}
-			if (totalDiff > 0) {
-				float totalWaterMoveAmount = fmax(0.0f, fmin(waterVolume[y][x], totalDiff / 2.0f));
-				float initialWaterVolume = waterVolume[y][x];
-				float initialsedimentVolume = sedimentVolume[y][x];
-				for (int i = -1; i <= 1; i++) {
-					for (int j = -1; j <= 1; j++) {
-						float diff = fmax(0.0f, (heightMap[y][x] + initialWaterVolume) - (heightMap[y + j][x + i] + waterVolume[y + j][x + i]));
-						float waterMoveAmount = (diff / totalDiff) * totalWaterMoveAmount;
-						float moveSedimentAmount = (waterMoveAmount / initialWaterVolume) * initialsedimentVolume;
-						waterVolume[y][x] -= waterMoveAmount;
-						sedimentVolume[y][x] -= moveSedimentAmount;
-						waterVolume[y + j][x + i] += waterMoveAmount;
-						sedimentVolume[y + j][x + i] += moveSedimentAmount;
-
-						if (waterVolume[y][x] < 0) waterVolume[y][x] = 0;
-						if (sedimentVolume[y][x] < 0) sedimentVolume[y][x] = 0;
-					}
+				else {
+					float normX = row[x - 1] / scale - row[x + 1] / scale; //difference in height of previous vertex and next vertex along the x axis
+					float normZ = prevRow[x] / scale - nextRow[x] / scale; //difference in height of previous vertex and next vertex along the z axis	
+					v.norm = pack_normal(normalize(vec3(normX, 2, normZ)));
 				}
 			}
-			
-				
-				
-			//evaporte water
-			waterVolume[y][x] *= 1 - ke;
-			if (waterVolume[y][x] < 0.0001) {
-				waterVolume[y][x] = 0;
-			}
-
-				
-			//deposit sediment
-			float maxSediment = waterVolume[y][x] * kc;
-			float depositAmount = fmax(0.0f, sedimentVolume[y][x] - maxSediment);
-			sedimentVolume[y][x] -= depositAmount;
-			heightMap[y][x] += depositAmount;
-			
 		}
-		
-	}
-
-
-	return heightMap;
+	});
 }
 
 
-float TerrainRenderer::homogeneousfbm(float x, float y, int numOctaves) {
-	float CurrentHeight = 0;
-
-	//add multiple octaves (frequencies that are double the last frequancy and half the amptitude) together to make rough terrain.
-	for (int i = 0; i < numOctaves; i++) {
-		float noise = perlinNoise(x * baseFrequency * pow(frequencyMultiplier, i), y * baseFrequency * pow(frequencyMultiplier, i)) * (float)pow(amtitudeMultiplier, i);
-
-		//add noise to current height function value
-		CurrentHeight += noise;
-
+//jumps straight to the end of the erosion if it's in the cache, otherwise starts it on the
+//simulation thread, render() shows its snapshots and stores the last one
+void TerrainRenderer::startErosion() {
+	erodingKey = 0;
+	if (useCache && totalIterations == std::floor(totalIterations)) {
+		erodingKey = erosionKey(terrainKey, erosionParams(), int(totalIterations));
+		if (heightmapCache.load(erodingKey, m_model.heightMap, &waterVolume)) {
+			erosionSimulation.cancel();
+			currentErodeIteration = int(totalIterations);
+			terrainNormals.clear();
+			updateSurface();
+			WaterRenderer::setSceneUpdated();
+			return;
+		}
 	}
 
-	return CurrentHeight;
+	erosionSimulation.start(m_model.heightMap, erosionParams(), int(std::ceil(totalIterations)));
 }
 
-float TerrainRenderer::heterogeneousfbm(float x, float y, int numOctaves) {
-	float CurrentHeight = 0;
-	float weight = 1.0f;
-
-	//add multiple octaves (frequencies that are double the last frequancy and half the amptitude) together to make rough terrain.
-	//weight the amptitude of each frequqncy by the current height of the function to smooth out valleys.
-	for (int i = 0; i < numOctaves; i++) {
-		float noise = perlinNoise(x*baseFrequency*pow(frequencyMultiplier,i), y*baseFrequency*pow(frequencyMultiplier,i));
-
-		//move range to [0..1] form [-1..1]
-		//means that adding octaves increases the height of mountains instead of just insreasing the roughness (average added height is positive instead of 0).
-		noise = (noise + 1) / 2.0f;
-		
-		//reduce amptitude of higher frequencies
-		noise *= (float)pow(amtitudeMultiplier, i);
-
-		//scale by current height (to smooth valleys)
-		float scaledNoise = noise * weight;
-		
-		//add noise to current height function value
-		CurrentHeight += scaledNoise;
-
-		//get the new weight for the next octave
-		weight = fmin(1.0f, CurrentHeight);
-	}
 
-	return CurrentHeight;
+//stops the erosion where it is, the terrain keeps the last snapshot shown
+void TerrainRenderer::stopErosion() {
+	shouldErodeTerrain = false;
+	erosionSimulation.cancel();
 }
 
-float TerrainRenderer::hybridMultifractal(float x, float y, int numOctaves) {
-	float CurrentHeight = 0;
-	float weight = 1.0f;
-	float previousNoiseVal = 1.0f;
-
-	//add multiple octaves (frequencies that are double the last frequancy and half the amptitude) together to make rough terrain.
-	//weight the amptitude of each frequqncy by the current height of the function to smooth out valleys.
-	for (int i = 0; i < numOctaves; i++) {
-		float noise = (perlinNoise(x * baseFrequency * pow(frequencyMultiplier, i), y * baseFrequency * pow(frequencyMultiplier, i)) + offset) * pow(pow(amtitudeMultiplier, i), H);
 
-		//scale by previous frequency
-		float scaledNoise = noise * weight;
+//shows a snapshot of the erosion, copied into the fields we already have
+void TerrainRenderer::showErosion(const ErosionSimulation::Snapshot& snapshot) {
+	int previousIteration = currentErodeIteration;
+	m_model.heightMap = snapshot.heightMap;
+	waterVolume = snapshot.waterVolume;
+	currentErodeIteration = snapshot.iteration;
 
-		//add noise to current height function value
-		CurrentHeight += scaledNoise;
+	//the heights no longer match the fbm, so normals have to come from the height map
+	terrainNormals.clear();
+	updateSurface();
 
-		//get the new weight for the next octave
-		weight = fmin(1.0f, scaledNoise);
+	//every 5th iteration (snapshots can skip some)
+	bool finished = currentErodeIteration == erosionSimulation.iterations();
+	if (currentErodeIteration / 5 != previousIteration / 5 || finished) {
+		// This tells the water renderer that it needs to update the 
+		// reflection and refraction textures
+		WaterRenderer::setSceneUpdated();
 	}
 
-	return CurrentHeight;
+	//keep the finished erosion, its settings were copied when it started
+	if (finished && erodingKey != 0) {
+		heightmapCache.store(erodingKey, m_model.heightMap, &waterVolume);
+	}
 }
 
 
+//restarts the tile streaming with the current terrain settings
+void TerrainRenderer::configureChunks() {
+	TileSettings settings;
+	settings.generation.fractal = fractalParams(numOctaves);
+	settings.generation.scale = scale;
+	settings.generation.squareSize = squareSize;
+	settings.offsetFractal = offsetParams();
+	settings.tileSize = 32 << tileSizeOption;
 
+	m_chunks.gpuBudget = size_t(gpuBudgetMB) << 20;
+	m_chunks.setCpuBudget(size_t(cpuBudgetMB) << 20);
+	m_chunks.configure(settings, permutationTable);
 
+	WaterRenderer::setSceneUpdated();
+}
 
 
+ErosionParams TerrainRenderer::erosionParams() const {
+	ErosionParams params;
+	params.type = ErosionType(terrainType);
+	params.talusThreshold = talusThreshold;
+	params.sedimentvolume = sedimentvolume;
+	params.thermalUpdate = ErosionUpdate(thermalUpdate);
+	params.traversal = ErosionTraversal(traversal);
+	params.hydraulic = HydraulicModel(hydraulicModel);
+	params.dropletsPerCell = dropletsPerCell;
+	params.dropletLifetime = dropletLifetime;
+	params.kr = kr;
+	params.ks = ks;
+	params.ke = ke;
+	params.kc = kc;
+	return params;
+}
 
 
+FractalParams TerrainRenderer::fractalParams(int numOctaves) const {
+	FractalParams params;
+	params.type = FractalType(fractalType);
+	params.basis = NoiseBasis(noiseBasis);
+	params.baseFrequency = baseFrequency;
+	params.numOctaves = numOctaves;
+	params.frequencyMultiplier = frequencyMultiplier;
+	params.amtitudeMultiplier = amtitudeMultiplier;
+	params.offset = offset;
+	params.H = H;
+	return params;
+}
 
 
-
-
-
-
+//texture transition offsets are a fixed 5 octave homogeneous fbm sampled once per vertex
+FractalParams TerrainRenderer::offsetParams() const {
+	FractalParams params = fractalParams(5);
+	params.type = FractalType::Homogeneous;
+	return params;
+}
@@ -1,6 +1,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
 #include <string>
 
 // glm
@@ -10,30 +14,55 @@
 // project
 #include "opengl.hpp"
 #include "terrain_mesh.hpp"
+#include "terrain_chunks.hpp"
+#include "terrain/heightfield.hpp"
+#include "terrain/noise.hpp"
+#include "terrain/permutation_cache.hpp"
+#include "terrain/fbm.hpp"
+#include "terrain/generator.hpp"
+#include "terrain/erosion.hpp"
+#include "terrain/erosion_simulation.hpp"
+#include "terrain/heightmap_cache.hpp"
+#include "terrain/background_job.hpp"
 #include "cgra/cgra_image.hpp"
 
 
 // Basic model that holds the shader, mesh and transform for drawing.
-// Can be copied and modified for adding in extra information for drawing
-// including textures for texture mapping etc.
+// Owns its mesh and textures, so it can be moved but not copied.
 struct basic_terrain_model {
 	GLuint shader = 0;
-	terrain::gl_mesh mesh;
+	terrain::split_mesh mesh;
 	glm::vec3 color{ 0.7 };
 	glm::mat4 modelTransform{ 1.0 };
-	GLuint grassTexture;
-	GLuint sandTexture;
-	GLuint stoneTexture;
+	cgra::gl_object grassTexture;
+	cgra::gl_object sandTexture;
+	cgra::gl_object stoneTexture;
 	float scale = 20;
 	GLuint offsetBuffer = 0;
 	std::vector<float> offsets = std::vector<float>();
-	std::vector<std::vector<float>> heightMap;
+	terrain::Heightfield heightMap; // mapSize x mapSize with a 1 sample border for the normals at the edges
+
+	// displacement mode: split meshes are drawn as a flat grid, displaced in the vertex shader by
+	// these R32F textures of the padded height map and water volume
+	bool displace = false;
+	cgra::gl_object heightTexture;
+	cgra::gl_object waterTexture;
+	glm::ivec2 displacementSize{ 0 };
 
 	float blendDist = 2.0f;
 	float transitionHeight1 = 0.0f;
 	float transitionHeight2 = 0.5f;
 
 	void draw(const glm::mat4& view, const glm::mat4 proj, const glm::vec4 &clip_plane);
+
+	// binds the shader, textures and uniforms shared by every mesh drawn with this model,
+	// then draws meshes with their own modelview matrix
+	void bind(const glm::mat4 proj, const glm::vec4& clip_plane);
+	void drawMesh(terrain::gl_mesh& mesh, const glm::mat4& modelview);
+	void drawMesh(terrain::split_mesh& mesh, const glm::mat4& modelview);
+
+	// one glTexSubImage2D per field (the textures are only reallocated when the size changes)
+	void uploadDisplacement(const terrain::Heightfield& heights, const terrain::Heightfield& water);
 };
 
 
@@ -45,8 +74,6 @@ public:
 
 private:
 
-	std::vector<std::vector<float>> testHM = std::vector<std::vector<float>>();
-
 	// geometry
 	basic_terrain_model m_model;
 	float worldSize = 100;
@@ -54,21 +81,10 @@ private:
 	float mapSize = worldSize / squareSize + 1;
 
 	//noise
-	int permutations[256] = {151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,
-							103,30,69,142,8,99,37,240,21,10,23,190, 6,148,247,120,234,75,0,
-							26,197,62,94,252,219,203,117,35,11,32,57,177,33,88,237,149,56,
-							87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
-							77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,
-							46,245,40,244,102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,
-							187,208, 89,18,169,200,196,135,130,116,188,159,86,164,100,109,
-							198,173,186, 3,64,52,217,226,250,124,123,5,202,38,147,118,126,
-							255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,223,183,
-							170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,
-							172,9,129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,
-							104,218,246,97,228,251,34,242,193,238,210,144,12,191,179,162,241,
-							81,51,145,235,249,14,239,107,49,192,214, 31,181,199,106,157,184,
-							84,204,176,115,121,50,45,127, 4,150,254,138,236,205,93,222,114,
-							67,29,24,72,243,141,128,195,78,66,215,61,156,180};
+	std::uint64_t seed = 0; // 0 is Perlin's reference permutation
+	std::shared_ptr<const terrain::PermutationTable> permutationTable;
+	std::mt19937_64 seedGenerator{ std::random_device()() };
+	char seedText[24] = "0";
 
 	//base terrain
 	float scale = 25;
@@ -78,6 +94,7 @@ private:
 	float amtitudeMultiplier = 0.5;
 
 	int fractalType = 1; //0 = normal terrain (homogeneous),		1 = smooth valleys (heterogeneous),		2 = Hybrid Multifractal
+	int noiseBasis = 0; //0 = Perlin (permutation table),		1 = integer hash,		2 = simplex
 
 	float offset = 0.7;
 	float H = 0.25;
@@ -89,6 +106,8 @@ private:
 
 	float talusThreshold = 1.0f;
 	float sedimentvolume = 0.05;
+	int thermalUpdate = 0; //0 = in place,	1 = jacobi (multithreaded),	2 = coloured in place (multithreaded)
+	int traversal = 1; //0 = columns (original order),	1 = tiled, for the in place sweeps
 
 	float totalIterations = 40;
 
@@ -97,8 +116,67 @@ private:
 	float ke = 0.5;
 	float kc = 0.1;
 
-	std::vector<std::vector<float>> waterVolume = std::vector<std::vector<float>>();
-	std::vector<std::vector<float>> sedimentVolume = std::vector<std::vector<float>>();
+	int hydraulicModel = 0; //0 = cells,	1 = pipes (shallow water),	2 = droplets
+	float dropletsPerCell = 0.25;
+	int dropletLifetime = 30;
+
+	terrain::Heightfield waterVolume; //of the erosion snapshot shown
+
+	//erodes on its own thread, render() shows the newest snapshot it finished
+	terrain::ErosionSimulation erosionSimulation;
+
+	//normals from the analytic gradient of the fbm, empty once erosion has changed the heights
+	std::vector<glm::vec3> terrainNormals;
+
+	//heights, normals and water volume of the mesh, rewritten after every erosion step
+	std::vector<terrain::dynamic_vertex> surfaceVertices;
+	bool gpuDisplacement = false; //upload the height map as a texture instead
+
+	//generated and eroded height maps are kept on disk, keyed by everything that decides them
+	bool useCache = true;
+	terrain::HeightmapCache heightmapCache{ terrain::HeightmapCache::defaultDirectory() };
+	terrain::CacheKey terrainKey = 0; //current un-eroded terrain
+	terrain::CacheKey erodingKey = 0; //erosion in progress, 0 if it can't be cached
+
+	//raw noise of every octave of the full resolution terrain, so sliders that only change how
+	//the octaves are combined don't sample the noise again
+	bool useOctaveCache = true;
+	std::shared_ptr<terrain::OctaveLayerCache> octaveLayers = std::make_shared<terrain::OctaveLayerCache>();
+
+	//a terrain generated off the render thread, waiting to be swapped in
+	struct GeneratedTerrain {
+		terrain::CacheKey key = 0;
+		int stride = 1; //> 1 for a low resolution preview
+		terrain::Heightfield heightMap;
+		std::vector<glm::vec3> normals;
+		std::vector<terrain::static_vertex> grid; //drawn with the shared grid_topology of its size
+		std::vector<terrain::dynamic_vertex> surface;
+	};
+
+	//settings for generating a terrain, copied from the members when it is requested
+	struct TerrainRequest {
+		terrain::GenerationParams params;
+		terrain::FractalParams offsetParams;
+		std::uint64_t seed = 0;
+		std::shared_ptr<const terrain::PermutationTable> perm;
+		terrain::HeightmapCache cache;
+		std::shared_ptr<terrain::OctaveLayerCache> layers; //null if it isn't used
+	};
+
+	terrain::BackgroundJob<GeneratedTerrain> regenerateJob;
+
+	//changes show a low resolution terrain straight away, the job then refines it
+	bool progressivePreview = true;
+	int previewOption = 1; //0 = 1/4,	1 = 1/8 resolution
+	int terrainStride = 1; //of the terrain being shown, erosion waits for full resolution
+
+	//streamed tiles around the camera instead of the single fixed size map (no erosion)
+	bool chunked = false;
+	terrain::ChunkedTerrain m_chunks;
+	glm::vec2 chunkCentre{ 0 }; //world position the camera orbits
+	int tileSizeOption = 1; //0 = 32,	1 = 64,	2 = 128 squares across
+	int cpuBudgetMB = 64;
+	int gpuBudgetMB = 128;
 
 	//textures
 	cgra::rgba_image textureImageGrass;
@@ -119,23 +197,33 @@ public:
 	void renderGUI();
 
 private:
-	//generate perlin noise
-	float perlinNoise(float x, float y);
-	glm::vec2 getCornerVector(int corner);
-	float fade(float t);
-	float lerp(float x, float p1, float p2);
-	void genPermutations();
+	//switch the perlin noise to another seed (permutation table)
+	void setSeed(std::uint64_t newSeed);
 
 	//generate terrain	
 	void generateTerrain(int numOctaves);
-	terrain::mesh_builder generatePlane();
+	void requestTerrain();
+	TerrainRequest terrainRequest(int numOctaves) const;
+	static bool makeTerrain(const TerrainRequest& request, int stride, GeneratedTerrain& terrain, const std::atomic<bool>& cancelled);
+	void swapInTerrain(GeneratedTerrain&& terrain);
+
+	static void buildGrid(int size, float spacing, int stride, const terrain::Fbm& offsetFbm,
+		std::vector<terrain::static_vertex>& vertices);
+	static void buildSurface(const terrain::Heightfield& heightMap, const terrain::Heightfield& waterVolume,
+		const std::vector<glm::vec3>& normals, float scale, std::vector<terrain::dynamic_vertex>& vertices);
+	void updateSurface();
+	void startErosion();
+	void stopErosion();
+	void showErosion(const terrain::ErosionSimulation::Snapshot& snapshot);
+	void configureChunks();
+	void renderChunks(const glm::mat4& view, const glm::mat4& proj, const glm::vec4& clip_plane);
 	//terrain::mesh_builder generateMeshFromHeightMap(std::vector<std::vector<float>> heightMap, int size, int numTriangles);
 
-	float homogeneousfbm(float x, float y, int numOctaves);
-	float heterogeneousfbm(float x, float y, int numOctaves);
-	float hybridMultifractal(float x, float y, int numOctaves);
+	//current base terrain settings
+	terrain::FractalParams fractalParams(int numOctaves) const;
+	terrain::FractalParams offsetParams() const;
 
-	std::vector<std::vector<float>> erodeTerrainTerraces(std::vector<std::vector<float>> heightMap, int size);
-	std::vector<std::vector<float>> erodeTerrainRealistic(std::vector<std::vector<float>> heightMap, int size);
+	//current erosion settings
+	terrain::ErosionParams erosionParams() const;
 
 };
\ No newline at end of file
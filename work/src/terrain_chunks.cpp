@@ -0,0 +1,141 @@
+
+// std
+#include <algorithm>
+#include <cmath>
+
+// project
+#include "terrain_chunks.hpp"
+
+
+using namespace std;
+using namespace glm;
+
+namespace terrain {
+
+	ChunkedTerrain::~ChunkedTerrain() {
+		clearGpu();
+	}
+
+
+	void ChunkedTerrain::configure(const TileSettings& settings, shared_ptr<const PermutationTable> perm) {
+		clearGpu();
+		m_wanted.clear();
+		m_settings = settings;
+		m_configured = true;
+		m_streamer.configure(settings, move(perm));
+
+		//every tile has the same triangles, they share one index buffer
+		m_topology = grid_topology::get(settings.tileSize + 1);
+	}
+
+
+	bool ChunkedTerrain::update(const vec3& cameraPos) {
+		if (!m_configured) return false;
+		m_frame++;
+
+		//tiles that overlap the view distance around the camera, nearest first
+		const float extent = tileExtent();
+		const int reach = int(ceil(viewDistance / extent));
+		const ivec2 centre = ivec2(floor(vec2(cameraPos.x, cameraPos.z) / extent));
+
+		vector<pair<float, TileCoord>> inRange;
+		for (int y = centre.y - reach; y <= centre.y + reach; y++) {
+			for (int x = centre.x - reach; x <= centre.x + reach; x++) {
+				vec2 lo = vec2(x, y) * extent;
+				vec2 nearest = clamp(vec2(cameraPos.x, cameraPos.z), lo, lo + extent);
+				float dist = distance(nearest, vec2(cameraPos.x, cameraPos.z));
+				if (dist <= viewDistance) inRange.emplace_back(dist, TileCoord{ x, y });
+			}
+		}
+		sort(inRange.begin(), inRange.end(), [](const pair<float, TileCoord>& a, const pair<float, TileCoord>& b) {
+			return a.first < b.first;
+		});
+
+		m_wanted.clear();
+		for (auto& tile : inRange) m_wanted.push_back(tile.second);
+		m_streamer.update(m_wanted);
+
+		//upload the nearest tiles that are ready
+		bool changed = false;
+		int uploads = 0;
+		for (const TileCoord& coord : m_wanted) {
+			auto uploaded = m_uploaded.find(coord);
+			if (uploaded != m_uploaded.end()) {
+				uploaded->second.lastUsed = m_frame;
+				continue;
+			}
+			if (uploads >= maxUploadsPerFrame) continue;
+
+			shared_ptr<const TileData> tile = m_streamer.find(coord);
+			if (!tile) continue;
+
+			GpuTile gpuTile = upload(*tile);
+			gpuTile.lastUsed = m_frame;
+			m_gpuUsed += gpuTile.bytes;
+			m_uploaded.emplace(coord, move(gpuTile));
+			uploads++;
+			changed = true;
+		}
+
+		//evict tiles out of view, least recently used first, until we fit in the budget
+		if (m_gpuUsed > gpuBudget) {
+			vector<pair<uint64_t, TileCoord>> unused;
+			for (auto& uploaded : m_uploaded) {
+				if (uploaded.second.lastUsed != m_frame) unused.emplace_back(uploaded.second.lastUsed, uploaded.first);
+			}
+			sort(unused.begin(), unused.end(), [](const pair<uint64_t, TileCoord>& a, const pair<uint64_t, TileCoord>& b) {
+				return a.first < b.first;
+			});
+			for (size_t i = 0; i < unused.size() && m_gpuUsed > gpuBudget; i++) {
+				auto evicted = m_uploaded.find(unused[i].second);
+				m_gpuUsed -= evicted->second.bytes;
+				m_uploaded.erase(evicted); // deletes the mesh
+				changed = true;
+			}
+		}
+
+		return changed;
+	}
+
+
+	void ChunkedTerrain::draw(const function<void(gl_mesh&)>& draw) {
+		for (const TileCoord& coord : m_wanted) {
+			auto uploaded = m_uploaded.find(coord);
+			if (uploaded == m_uploaded.end()) continue;
+			draw(uploaded->second.mesh);
+		}
+	}
+
+
+	void ChunkedTerrain::clearGpu() {
+		m_uploaded.clear();
+		m_gpuUsed = 0;
+	}
+
+
+	ChunkedTerrain::GpuTile ChunkedTerrain::upload(const TileData& tile) const {
+		const int n = m_settings.tileSize + 1;
+		const float squareSize = m_settings.generation.squareSize;
+		const ivec2 origin = ivec2(tile.coord.x, tile.coord.y) * m_settings.tileSize;
+
+		mesh_builder mb;
+		mb.vertices.resize(size_t(n) * n);
+		for (int y = 0; y < n; y++) {
+			const float* row = tile.heightMap.row(y);
+			for (int x = 0; x < n; x++) {
+				size_t i = size_t(y) * n + x;
+				mesh_vertex& v = mb.vertices[i];
+				//global sample positions, so textures carry on across tiles
+				v.pos = vec3((origin.x + x) * squareSize, row[x], (origin.y + y) * squareSize);
+				v.norm = tile.normals[i];
+				v.uv = vec2(origin.x + x, origin.y + y);
+				v.offset = tile.offsets[i];
+			}
+		}
+
+		GpuTile gpuTile;
+		gpuTile.mesh = mb.build_grid(n);
+		gpuTile.bytes = mb.vertices.size() * sizeof(mesh_vertex); // the indices are shared
+		return gpuTile;
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "terrain_mesh.hpp"
+#include "terrain/tile_streamer.hpp"
+
+
+namespace terrain {
+
+	// Infinite terrain made of tiles streamed in around the camera.
+	// Tiles are generated on worker threads by a TileStreamer (under the CPU budget), uploaded a
+	// few per frame once they are ready and evicted from the GPU least recently used first when
+	// the GPU budget is exceeded. Neighbouring tiles share their edge samples, so there are no seams.
+	class ChunkedTerrain {
+	public:
+		float viewDistance = 300;					// tiles closer than this to the camera are streamed in
+		std::size_t gpuBudget = std::size_t(128) << 20;
+		int maxUploadsPerFrame = 4;
+
+		ChunkedTerrain() = default;
+		~ChunkedTerrain();
+
+		ChunkedTerrain(const ChunkedTerrain&) = delete;
+		ChunkedTerrain& operator=(const ChunkedTerrain&) = delete;
+
+		// drops every tile and starts streaming with new settings
+		void configure(const TileSettings& settings, std::shared_ptr<const PermutationTable> perm);
+
+		void setCpuBudget(std::size_t bytes) { m_streamer.setMemoryBudget(bytes); }
+
+		// streams tiles around the camera, which is given in the terrain's (untransformed) space.
+		// returns true if any tiles were uploaded or evicted
+		bool update(const glm::vec3& cameraPos);
+
+		// calls draw(mesh) for every uploaded tile in view distance. Vertex positions are in the
+		// terrain's space (not local to the tile) so the shaders' world space texturing lines up
+		void draw(const std::function<void(gl_mesh&)>& draw);
+
+		// deletes every uploaded mesh, the generated tiles stay cached
+		void clearGpu();
+
+		std::size_t cpuMemoryUsed() const { return m_streamer.memoryUsed(); }
+		std::size_t gpuMemoryUsed() const { return m_gpuUsed; }
+		std::size_t tilesGenerated() const { return m_streamer.tileCount(); }
+		std::size_t tilesPending() const { return m_streamer.tilesPending(); }
+		std::size_t tilesUploaded() const { return m_uploaded.size(); }
+		std::size_t tilesInView() const { return m_wanted.size(); }
+
+	private:
+		struct GpuTile {
+			gl_mesh mesh;
+			std::size_t bytes = 0;
+			std::uint64_t lastUsed = 0; // frame it was last in view
+		};
+
+		TileSettings m_settings;
+		bool m_configured = false;
+		TileStreamer m_streamer;
+
+		std::unordered_map<TileCoord, GpuTile, TileCoordHash> m_uploaded;
+		std::vector<TileCoord> m_wanted; // nearest first
+		std::shared_ptr<const grid_topology> m_topology; // every tile's triangles, held while streaming
+		std::size_t m_gpuUsed = 0;
+		std::uint64_t m_frame = 0;
+
+		GpuTile upload(const TileData& tile) const;
+
+		// world size of one tile
+		float tileExtent() const { return m_settings.tileSize * m_settings.generation.squareSize; }
+	};
+}
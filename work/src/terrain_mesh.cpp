@@ -1,5 +1,9 @@
 
 // std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <map>
 #include <stdexcept>
 
 // project
@@ -7,6 +11,7 @@
 
 
 
+using namespace cgra;
 using namespace glm;
 
 namespace terrain {
@@ -15,55 +20,124 @@ namespace terrain {
 		if (vao == 0) return;
 		// bind our VAO which sets up all our buffers and data for us
 		glBindVertexArray(vao);
+		if (topology) {
+			topology->draw();
+			return;
+		}
 		// tell opengl to draw our VAO using the draw mode and how many verticies to render
 		glDrawElements(mode, index_count, GL_UNSIGNED_INT, 0);
 	}
 
 	void gl_mesh::destroy() {
 		// delete the data buffers
-		glDeleteVertexArrays(1, &vao);
-		glDeleteBuffers(1, &vbo);
-		glDeleteBuffers(1, &ibo);
+		*this = gl_mesh();
 	}
 
 
-	gl_mesh mesh_builder::build() const {
+	namespace {
+		// strips along the rows of a size x size grid, restart separates them. The vertices go
+		// (x, y + 1), (x, y), (x + 1, y + 1), (x + 1, y) ..., which keeps the winding of the
+		// triangles the grid used to be drawn with
+		template <typename Index>
+		std::vector<Index> strip_indices(int size, Index restart) {
+			std::vector<Index> indices;
+			indices.reserve(size_t(size - 1) * (2 * size + 1));
+			for (int y = 0; y < size - 1; y++) {
+				if (y > 0) indices.push_back(restart);
+				for (int x = 0; x < size; x++) {
+					indices.push_back(Index((y + 1) * size + x));
+					indices.push_back(Index(y * size + x));
+				}
+			}
+			return indices;
+		}
+	}
 
-		gl_mesh m;
-		glGenVertexArrays(1, &m.vao); // VAO stores information about how the buffers are set up
-		glGenBuffers(1, &m.vbo); // VBO stores the vertex data
-		glGenBuffers(1, &m.ibo); // IBO stores the indices that make up primitives
 
+	void grid_topology::draw() const {
+		glEnable(GL_PRIMITIVE_RESTART);
+		glPrimitiveRestartIndex(type == GL_UNSIGNED_SHORT ? 0xFFFF : 0xFFFFFFFF);
+		glDrawElements(GL_TRIANGLE_STRIP, index_count, type, 0);
+		glDisable(GL_PRIMITIVE_RESTART);
+	}
 
-		// VAO
-		//
-		glBindVertexArray(m.vao);
 
-		
-		// VBO (single buffer, interleaved)
-		//
-		glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
-		// upload ALL the vertex data in one buffer
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(mesh_vertex), &vertices[0], GL_STATIC_DRAW);
+	std::shared_ptr<const grid_topology> grid_topology::get(int size) {
+		// only used from the GL thread, so no lock
+		static std::map<int, std::weak_ptr<const grid_topology>> shared;
+		if (auto existing = shared[size].lock()) return existing;
+
+		auto topology = std::make_shared<grid_topology>();
+		topology->ibo = gl_object::gen_buffer();
+		// not uploaded through GL_ELEMENT_ARRAY_BUFFER, that would bind it to whatever VAO is bound
+		glBindBuffer(GL_COPY_WRITE_BUFFER, topology->ibo);
+		if (size_t(size) * size < 0xFFFF) {
+			std::vector<GLushort> indices = strip_indices<GLushort>(size, 0xFFFF);
+			glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+			topology->ibo.set_bytes(indices.size() * sizeof(GLushort));
+			topology->type = GL_UNSIGNED_SHORT;
+			topology->index_count = int(indices.size());
+		}
+		else {
+			std::vector<GLuint> indices = strip_indices<GLuint>(size, 0xFFFFFFFF);
+			glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+			topology->ibo.set_bytes(indices.size() * sizeof(GLuint));
+			topology->type = GL_UNSIGNED_INT;
+			topology->index_count = int(indices.size());
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		shared[size] = topology;
+		return topology;
+	}
+
+
+	namespace {
+		// creates the VAO and VBO of a mesh and uploads the vertices, leaves the VAO bound
+		void upload_vertices(gl_mesh& m, const std::vector<mesh_vertex>& vertices) {
+			m.vao = gl_object::gen_vertex_array(); // VAO stores information about how the buffers are set up
+			m.vbo = gl_object::gen_buffer(); // VBO stores the vertex data
+
+
+			// VAO
+			//
+			glBindVertexArray(m.vao);
+
 
-		// this buffer will use location=0 when we use our VAO
-		glEnableVertexAttribArray(0);
-		// tell opengl how to treat data in location=0 - the data is treated in lots of 3 (3 floats = vec3)
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, pos)));
+			// VBO (single buffer, interleaved)
+			//
+			glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
+			// upload ALL the vertex data in one buffer
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(mesh_vertex), &vertices[0], GL_STATIC_DRAW);
+			m.vbo.set_bytes(vertices.size() * sizeof(mesh_vertex));
 
-		// do the same thing for Normals but bind it to location=1
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, norm)));
+			// this buffer will use location=0 when we use our VAO
+			glEnableVertexAttribArray(0);
+			// tell opengl how to treat data in location=0 - the data is treated in lots of 3 (3 floats = vec3)
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, pos)));
 
-		// do the same thing for UVs but bind it to location=2 - the data is treated in lots of 2 (2 floats = vec2)
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, uv)));
+			// do the same thing for Normals but bind it to location=1
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, norm)));
 
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void*)(offsetof(mesh_vertex, offset)));
+			// do the same thing for UVs but bind it to location=2 - the data is treated in lots of 2 (2 floats = vec2)
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, uv)));
 
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void*)(offsetof(mesh_vertex, waterVolume)));
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void*)(offsetof(mesh_vertex, offset)));
+
+			glEnableVertexAttribArray(4);
+			glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void*)(offsetof(mesh_vertex, waterVolume)));
+		}
+	}
+
+
+	gl_mesh mesh_builder::build() const {
+
+		gl_mesh m;
+		upload_vertices(m, vertices);
+		m.ibo = gl_object::gen_buffer(); // IBO stores the indices that make up primitives
 
 
 		// IBO
@@ -71,6 +145,7 @@ namespace terrain {
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ibo);
 		// upload the indices for drawing primitives
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		m.ibo.set_bytes(sizeof(unsigned int) * indices.size());
 
 
 		// set the index count and draw modes
@@ -82,4 +157,109 @@ namespace terrain {
 
 		return m;
 	}
-}
\ No newline at end of file
+
+
+	gl_mesh mesh_builder::build_grid(int size) const {
+		assert(vertices.size() == size_t(size) * size);
+
+		gl_mesh m;
+		upload_vertices(m, vertices);
+
+		// the shared indices, bound to this VAO
+		m.topology = grid_topology::get(size);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.topology->ibo);
+		m.mode = GL_TRIANGLE_STRIP;
+		m.index_count = m.topology->index_count;
+
+		glBindVertexArray(0);
+
+		return m;
+	}
+
+
+	GLuint pack_normal(const vec3& n) {
+		//10 bit two's complement per component, w is unused
+		auto component = [](float v) {
+			return GLuint(int(std::round(std::clamp(v, -1.0f, 1.0f) * 511.0f)) & 0x3FF);
+		};
+		return component(n.x) | (component(n.y) << 10) | (component(n.z) << 20);
+	}
+
+
+	namespace {
+		// Replaces the contents of a buffer. Same sized data orphans the old storage first, so the
+		// driver can hand out fresh memory instead of waiting for draws that still read the old data.
+		void upload(GLenum target, gl_object& buffer, size_t bytes, const void* data, GLenum usage) {
+			glBindBuffer(target, buffer);
+			if (bytes == buffer.bytes()) {
+				glBufferData(target, bytes, nullptr, usage);
+				glBufferSubData(target, 0, bytes, data);
+			}
+			else {
+				glBufferData(target, bytes, data, usage);
+				buffer.set_bytes(bytes);
+			}
+		}
+	}
+
+
+	void split_mesh::set_grid(const std::vector<static_vertex>& vertices, int size) {
+		assert(vertices.size() == size_t(size) * size);
+		if (vao == 0) {
+			vao = gl_object::gen_vertex_array();
+			static_vbo = gl_object::gen_buffer();
+			dynamic_vbo = gl_object::gen_buffer();
+
+			glBindVertexArray(vao);
+
+			// static stream
+			glBindBuffer(GL_ARRAY_BUFFER, static_vbo);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(static_vertex), (void*)(offsetof(static_vertex, pos)));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(static_vertex), (void*)(offsetof(static_vertex, uv)));
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(static_vertex), (void*)(offsetof(static_vertex, offset)));
+
+			// dynamic stream
+			glBindBuffer(GL_ARRAY_BUFFER, dynamic_vbo);
+			glEnableVertexAttribArray(5);
+			glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(dynamic_vertex), (void*)(offsetof(dynamic_vertex, height)));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(dynamic_vertex), (void*)(offsetof(dynamic_vertex, norm)));
+			glEnableVertexAttribArray(4);
+			glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(dynamic_vertex), (void*)(offsetof(dynamic_vertex, waterVolume)));
+
+			glBindVertexArray(0);
+		}
+
+		upload(GL_ARRAY_BUFFER, static_vbo, vertices.size() * sizeof(static_vertex), vertices.data(), GL_STATIC_DRAW);
+
+		// the element buffer binding is part of the VAO
+		if (int(vertices.size()) != vertex_count || !topology) {
+			topology = grid_topology::get(size);
+			glBindVertexArray(vao);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, topology->ibo);
+			glBindVertexArray(0);
+		}
+		vertex_count = int(vertices.size());
+	}
+
+
+	void split_mesh::set_surface(const std::vector<dynamic_vertex>& vertices) {
+		assert(int(vertices.size()) == vertex_count);
+		upload(GL_ARRAY_BUFFER, dynamic_vbo, vertices.size() * sizeof(dynamic_vertex), vertices.data(), GL_DYNAMIC_DRAW);
+	}
+
+
+	void split_mesh::draw() {
+		if (vao == 0 || !topology) return;
+		glBindVertexArray(vao);
+		topology->draw();
+	}
+
+
+	void split_mesh::destroy() {
+		*this = split_mesh();
+	}
+}
@@ -3,6 +3,7 @@
 
 // std
 #include <iostream>
+#include <memory>
 #include <vector>
 
 // glm
@@ -15,22 +16,42 @@
 
 namespace terrain {
 
+	// Index buffer of a size x size vertex grid (row major), drawn as one triangle strip per row of
+	// squares with primitive restart in between. It only depends on the size, so every mesh of that
+	// size shares one. The indices are 16 bit when the grid has fewer than 65535 vertices (0xFFFF
+	// is the restart index), which halves them again.
+	struct grid_topology {
+		cgra::gl_object ibo;
+		GLenum type = GL_UNSIGNED_INT;
+		int index_count = 0;
+
+		// draws the strips, the ibo has to be bound to the current VAO
+		void draw() const;
+
+		// the topology for a grid size, built on first use and kept while any mesh holds it.
+		// needs the GL context, like everything else here
+		static std::shared_ptr<const grid_topology> get(int size);
+	};
+
+
 	// A data structure for holding buffer IDs and other information related to drawing.
 	// Also has a helper functions for drawing the mesh and deleting the gl buffers.
+	// Owns its buffers, so it can only be moved; they are deleted with the mesh.
 	// location 1 : positions (vec3)
 	// location 2 : normals (vec3)
 	// location 3 : uv (vec2)
 	struct gl_mesh {
-		GLuint vao = 0;
-		GLuint vbo = 0;
-		GLuint ibo = 0;
+		cgra::gl_object vao;
+		cgra::gl_object vbo;
+		cgra::gl_object ibo;
 		GLenum mode = 0; // mode to draw in, eg: GL_TRIANGLES
 		int index_count = 0; // how many indicies to draw (no primitives)
+		std::shared_ptr<const grid_topology> topology; // drawn instead of ibo when set
 
 		// calls the draw function on mesh data
 		void draw();
 
-		// deletes the gl buffers (cleans up all the data)
+		// deletes the gl buffers now instead of with the mesh
 		void destroy();
 	};
 
@@ -44,6 +65,52 @@ namespace terrain {
 	};
 
 
+	// Grid vertex data that stays the same while the terrain erodes
+	struct static_vertex {
+		glm::vec3 pos{0}; // y is 0, the height comes from the dynamic stream
+		glm::vec2 uv{0};
+		float offset = 0;
+	};
+
+	// Vertex data that changes with the heights, 12 bytes instead of the 40 of a mesh_vertex
+	struct dynamic_vertex {
+		float height = 0;
+		GLuint norm = 0; // packed by pack_normal
+		float waterVolume = 0;
+	};
+
+	// packs a unit normal into GL_INT_2_10_10_10_REV, which the shader reads back as a normalized vec3
+	GLuint pack_normal(const glm::vec3& n);
+
+
+	// A terrain grid drawn from two vertex buffers, so eroding only re-uploads what changed.
+	// The static buffer is uploaded once per grid; the dynamic buffer is orphaned and rewritten in
+	// place whenever the heights change. The VAO and buffers are reused for the life of the mesh,
+	// which owns them (move only).
+	// location 0 : positions (vec3, static, with y = 0)
+	// location 1 : normals (packed vec3, dynamic)
+	// location 2 : uv (vec2, static)
+	// location 3 : transition offset (float, static)
+	// location 4 : water volume (float, dynamic)
+	// location 5 : height (float, dynamic), added to the position by the vertex shader
+	struct split_mesh {
+		cgra::gl_object vao;
+		cgra::gl_object static_vbo;
+		cgra::gl_object dynamic_vbo;
+		std::shared_ptr<const grid_topology> topology;
+		int vertex_count = 0;
+
+		// uploads a new size x size grid, creating the buffers on first use
+		void set_grid(const std::vector<static_vertex>& vertices, int size);
+
+		// rewrites the dynamic stream, one entry per grid vertex
+		void set_surface(const std::vector<dynamic_vertex>& vertices);
+
+		void draw();
+		void destroy();
+	};
+
+
 	// Mesh builder object used to create an mesh by taking vertex and index information
 	// and uploading them to OpenGL.
 	struct mesh_builder {
@@ -77,6 +144,10 @@ namespace terrain {
 
 		gl_mesh build() const;
 
+		// builds a size x size grid mesh (vertices row major) that draws the shared grid_topology
+		// instead of indices
+		gl_mesh build_grid(int size) const;
+
 		void print() const {
 			std::cout << "pos" << std::endl;
 			for (mesh_vertex v : vertices) {
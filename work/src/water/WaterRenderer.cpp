@@ -56,15 +56,16 @@ vec4 WaterRenderer::getClipPlane(Type type)
 
 /**
  * Creates the fbos for the reflection and refraction textures.
+ * Replacing the old ones deletes them.
  */
 void WaterRenderer::initFbos()
 {
-    glGenFramebuffers(1, &refraction_fbo);
+    refraction_fbo = gl_object::gen_framebuffer();
     glBindFramebuffer(GL_FRAMEBUFFER, refraction_fbo);
     refraction_texture = generateColourTexture(Type::Refraction);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    glGenFramebuffers(1, &reflection_fbo);
+    reflection_fbo = gl_object::gen_framebuffer();
     glBindFramebuffer(GL_FRAMEBUFFER, reflection_fbo);
     reflection_texture = generateColourTexture(Type::Reflection);
 
@@ -73,19 +74,7 @@ void WaterRenderer::initFbos()
     glViewport(0, 0, window_size.x, window_size.y);
 }
 
-/**
- * Deletes the current fbos and textures
- */
-void WaterRenderer::destroy()
-{
-    glDeleteFramebuffers(1, &refraction_fbo);
-    glDeleteFramebuffers(1, &reflection_fbo);
-    glDeleteTextures(1, &refraction_texture);
-    glDeleteTextures(1, &reflection_texture);
-    glDeleteTextures(1, &depth_texture);
-}
-
-int WaterRenderer::generateColourTexture(Type type)
+gl_object WaterRenderer::generateColourTexture(Type type)
 {
     int width = window_size.x;
     int height = window_size.y;
@@ -98,19 +87,20 @@ int WaterRenderer::generateColourTexture(Type type)
         height /= 2;
 
         // reflection needs depth buffer
-        GLuint depth_buffer;
-        glGenRenderbuffers(1, &depth_buffer);
-        glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+        reflection_depth_buffer = gl_object::gen_renderbuffer();
+        glBindRenderbuffer(GL_RENDERBUFFER, reflection_depth_buffer);
         glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+        reflection_depth_buffer.set_bytes(size_t(width) * height * 4);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, reflection_depth_buffer);
     }
     else if (type == Type::Refraction)
     {
         // Depth texture attachment to get the depth/distance of the terrain surface from the camera
-        glGenTextures(1, &depth_texture);
+        depth_texture = gl_object::gen_texture();
         glBindTexture(GL_TEXTURE_2D, depth_texture);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height,
                      0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+        depth_texture.set_bytes(size_t(width) * height * 4);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -119,10 +109,10 @@ int WaterRenderer::generateColourTexture(Type type)
         glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_texture, 0);
     }
 
-    GLuint colour_texture;
-    glGenTextures(1, &colour_texture);
+    gl_object colour_texture = gl_object::gen_texture();
     glBindTexture(GL_TEXTURE_2D, colour_texture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    colour_texture.set_bytes(size_t(width) * height * 4);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -228,18 +218,12 @@ void WaterRenderer::renderGUI()
     ImGui::SliderFloat("Murkiness", &water->murkiness, 0, 1.0, "");
 }
 
-WaterRenderer::~WaterRenderer()
-{
-    destroy();
-}
-
 /**
  * Resizes the fbos
  */
 void WaterRenderer::resize(int width, int height)
 {
     window_size = ivec2(width, height);
-    destroy();
     initFbos(); // create new fbos with updated window size
     water->setTextures(refraction_texture, reflection_texture, depth_texture);
 }
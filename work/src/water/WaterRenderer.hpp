@@ -44,11 +44,13 @@ private:
 
     std::unique_ptr<WaterSurface> water;
 
-    GLuint refraction_fbo;
-    GLuint reflection_fbo;
-    GLuint refraction_texture;
-    GLuint reflection_texture;
-    GLuint depth_texture;
+    // owned here and recreated on resize, the water surface only samples the textures
+    cgra::gl_object refraction_fbo;
+    cgra::gl_object reflection_fbo;
+    cgra::gl_object refraction_texture;
+    cgra::gl_object reflection_texture;
+    cgra::gl_object depth_texture;
+    cgra::gl_object reflection_depth_buffer;
 
     std::weak_ptr<TerrainRenderer> terrain_renderer;
     std::weak_ptr<FogRenderer> fog_renderer;
@@ -57,16 +59,13 @@ private:
     glm::ivec2 window_size;
 
     void initFbos();
-    int generateColourTexture(Type type);
+    cgra::gl_object generateColourTexture(Type type);
     glm::vec4 getClipPlane(Type type);
 
     void renderRefraction(const glm::mat4 &view, const glm::mat4 &proj);
     void renderReflection(const glm::mat4 &view, const glm::mat4 &proj);
-    void destroy();
 
 public:
-    ~WaterRenderer();
-
     // setup
     WaterRenderer(std::weak_ptr<TerrainRenderer> terrain_renderer, std::weak_ptr<SkyBox> sky, std::weak_ptr<FogRenderer> fog);
 
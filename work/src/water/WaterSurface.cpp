@@ -46,12 +46,16 @@ WaterSurface::WaterSurface(float size, float height) : height(height)
     // normal map
     rgba_image normal_image = rgba_image(CGRA_SRCDIR + string("/res/textures/normal_map.png"));
     normal_image.wrap = vec2(GL_REPEAT, GL_REPEAT);
-    normal_map = normal_image.uploadTexture();
+    normal_map = gl_object::gen_texture();
+    normal_image.uploadTexture(GL_RGBA8, normal_map);
+    normal_map.set_bytes(normal_image.data.size() * 4 / 3); // with the mipmaps
 
     // dudv map
     rgba_image dudv_image = rgba_image(CGRA_SRCDIR + string("/res/textures/dudv_map.png"));
     dudv_image.wrap = vec2(GL_REPEAT, GL_REPEAT);
-    dudv_map = dudv_image.uploadTexture();
+    dudv_map = gl_object::gen_texture();
+    dudv_image.uploadTexture(GL_RGBA8, dudv_map);
+    dudv_map.set_bytes(dudv_image.data.size() * 4 / 3);
 
     // bind to texture units
     glUseProgram(shader);
@@ -113,14 +117,8 @@ void WaterSurface::updateOffsets(float delta_time)
 
 WaterSurface::~WaterSurface()
 {
-    // Destroy all the textures
-    glDeleteTextures(1, &refraction_texture);
-    glDeleteTextures(1, &reflection_texture);
-    glDeleteTextures(1, &normal_map);
-    glDeleteTextures(1, &dudv_map);
-    glDeleteTextures(1, &depth_texture);
+    // the textures and mesh are deleted with their gl_objects
     glDeleteProgram(shader);
-    mesh.destroy();
 }
 
 void WaterSurface::unbindTextures()
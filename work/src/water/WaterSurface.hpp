@@ -42,8 +42,9 @@ private:
     DistortionOffset primary_offset = DistortionOffset({-1, -1});
     DistortionOffset secondary_offset = DistortionOffset({0, -1});
 
-    // Textures
-    GLuint refraction_texture, reflection_texture, normal_map, dudv_map, depth_texture;
+    // Textures, the refraction, reflection and depth textures belong to the WaterRenderer
+    GLuint refraction_texture, reflection_texture, depth_texture;
+    cgra::gl_object normal_map, dudv_map;
 
     cgra::gl_mesh mesh;
     glm::vec3 colour{0, 0, 1}; // temp